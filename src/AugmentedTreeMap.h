@@ -0,0 +1,653 @@
+#ifndef AISDI_MAPS_AUGMENTEDTREEMAP_H
+#define AISDI_MAPS_AUGMENTEDTREEMAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "Treap.h"
+
+namespace aisdi
+{
+
+// Monoids for AugmentedTreeMap: an associative operator() with identity() as its neutral element.
+// An item contributes its value converted to value_type, unless the monoid measures it itself
+// with measure(value).
+template <typename T>
+struct SumMonoid
+{
+  using value_type = T;
+
+  T identity() const
+  {
+    return T();
+  }
+
+  T operator()(const T& left, const T& right) const
+  {
+    return left + right;
+  }
+};
+
+template <typename T>
+struct MinMonoid
+{
+  using value_type = T;
+
+  T identity() const
+  {
+    return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+  }
+
+  T operator()(const T& left, const T& right) const
+  {
+    return std::min(left, right);
+  }
+};
+
+template <typename T>
+struct MaxMonoid
+{
+  using value_type = T;
+
+  T identity() const
+  {
+    return std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+  }
+
+  T operator()(const T& left, const T& right) const
+  {
+    return std::max(left, right);
+  }
+};
+
+// Counts items whatever their values, which makes AugmentedTreeMap an order statistic tree.
+struct CountMonoid
+{
+  using value_type = std::size_t;
+
+  std::size_t identity() const
+  {
+    return 0;
+  }
+
+  std::size_t operator()(std::size_t left, std::size_t right) const
+  {
+    return left + right;
+  }
+
+  template <typename Value>
+  std::size_t measure(const Value&) const
+  {
+    return 1;
+  }
+};
+
+namespace detail
+{
+
+template <typename Monoid, typename Value>
+class HasMeasure
+{
+  template <typename M>
+  static auto test(int) -> decltype(std::declval<const M&>().measure(std::declval<const Value&>()), std::true_type());
+  template <typename>
+  static std::false_type test(...);
+
+public:
+  static const bool value = decltype(test<Monoid>(0))::value;
+};
+
+}
+
+// Ordered map kept balanced as a treap, where every node also stores the monoid product of the
+// values in its subtree, in key order. Insertions, removals and rotations refresh the products on
+// the way back up, so aggregate(first, last) combines O(log n) stored products instead of visiting
+// the range. The monoid only has to be associative, not commutative.
+// There is no operator[] and iterators are read only: writing a value behind the map's back would
+// leave the products stale, set() updates them instead. OrderStatisticTreeMap, whose counts do
+// not depend on the values, builds on the protected part.
+template <typename KeyType, typename ValueType, typename Monoid = SumMonoid<ValueType>>
+class AugmentedTreeMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = const value_type&;
+  using const_reference = const value_type&;
+  using aggregate_type = typename Monoid::value_type;
+
+  class ConstIterator;
+  using iterator = ConstIterator;
+  using const_iterator = ConstIterator;
+
+protected:
+  struct Node
+  {
+    value_type data;
+    Node *left, *right, *parent;
+    std::uint32_t priority;
+    aggregate_type aggregate;
+
+    Node() : data(), left(nullptr), right(nullptr), parent(nullptr), priority(0), aggregate() {}
+    Node(const key_type& key, const mapped_type& value, std::uint32_t priority_, const aggregate_type& aggregate_)
+      : data(key, value), left(nullptr), right(nullptr), parent(nullptr), priority(priority_),
+        aggregate(aggregate_)
+    {}
+  };
+
+  // head is the end() sentinel, head.left holds the real root.
+  Node head;
+  size_type size;
+  detail::TreapPriorities priorities;
+  Monoid monoid;
+
+  Node* sentinel() const
+  {
+    return const_cast<Node*>(&head);
+  }
+
+  aggregate_type measure(const mapped_type& value, std::true_type) const
+  {
+    return monoid.measure(value);
+  }
+
+  aggregate_type measure(const mapped_type& value, std::false_type) const
+  {
+    return aggregate_type(value);
+  }
+
+  aggregate_type measure(const mapped_type& value) const
+  {
+    return measure(value, std::integral_constant<bool, detail::HasMeasure<Monoid, mapped_type>::value>());
+  }
+
+  aggregate_type aggregateOf(const Node* node) const
+  {
+    return node == nullptr ? monoid.identity() : node->aggregate;
+  }
+
+  void update(Node* node) const
+  {
+    node->aggregate = monoid(monoid(aggregateOf(node->left), measure(node->data.second)), aggregateOf(node->right));
+  }
+
+  void updateUpwards(Node* node) const
+  {
+    for(; node != &head; node = node->parent)
+      update(node);
+  }
+
+  void rotateUp(Node* node)
+  {
+    Node* parent = node->parent;
+    Node* grand = parent->parent;
+    if(node == parent->left)
+    {
+      parent->left = node->right;
+      if(node->right != nullptr)
+        node->right->parent = parent;
+      node->right = parent;
+    }
+    else
+    {
+      parent->right = node->left;
+      if(node->left != nullptr)
+        node->left->parent = parent;
+      node->left = parent;
+    }
+    parent->parent = node;
+    node->parent = grand;
+    if(grand->left == parent)
+      grand->left = node;
+    else
+      grand->right = node;
+    // node now spans exactly the items its parent did.
+    node->aggregate = parent->aggregate;
+    update(parent);
+  }
+
+  Node* lookfor(const key_type& key) const
+  {
+    Node* current = head.left;
+    while(current != nullptr)
+    {
+      if(key < current->data.first)
+        current = current->left;
+      else if(current->data.first < key)
+        current = current->right;
+      else
+        return current;
+    }
+    return sentinel();
+  }
+
+  static Node* clone(const Node* other, Node* parent)
+  {
+    if(other == nullptr)
+      return nullptr;
+    Node* node = new Node(other->data.first, other->data.second, other->priority, other->aggregate);
+    node->parent = parent;
+    try
+    {
+      node->left = clone(other->left, node);
+      node->right = clone(other->right, node);
+    }
+    catch(...)
+    {
+      node->parent = nullptr;
+      destroy(node);
+      throw;
+    }
+    return node;
+  }
+
+  static void destroy(Node* node)
+  {
+    // iterative post-order walk, node must already be detached from its parent.
+    while(node != nullptr)
+    {
+      if(node->left != nullptr)
+        node = node->left;
+      else if(node->right != nullptr)
+        node = node->right;
+      else
+      {
+        Node* parent = node->parent;
+        if(parent != nullptr)
+        {
+          if(parent->left == node)
+            parent->left = nullptr;
+          else
+            parent->right = nullptr;
+        }
+        delete node;
+        node = parent;
+      }
+    }
+  }
+
+  // Takes tree of count items as the whole content of an empty map.
+  void adopt(Node* tree, size_type count)
+  {
+    head.left = tree;
+    if(tree != nullptr)
+      tree->parent = &head;
+    size = count;
+  }
+
+  void steal(AugmentedTreeMap& other)
+  {
+    adopt(other.head.left, other.size);
+    other.head.left = nullptr;
+    other.size = 0;
+  }
+
+  // Returns the node of key, creating it with value when missing. inserted tells which happened.
+  Node* findOrInsert(const key_type& key, const mapped_type& value, bool& inserted)
+  {
+    Node* parent = &head;
+    Node* current = head.left;
+    bool goLeft = true;
+    while(current != nullptr)
+    {
+      parent = current;
+      if(key < current->data.first)
+      {
+        current = current->left;
+        goLeft = true;
+      }
+      else if(current->data.first < key)
+      {
+        current = current->right;
+        goLeft = false;
+      }
+      else
+      {
+        inserted = false;
+        return current;
+      }
+    }
+    Node* newNode = new Node(key, value, priorities.next(), measure(value));
+    newNode->parent = parent;
+    if(goLeft)
+      parent->left = newNode;
+    else
+      parent->right = newNode;
+    size++;
+    updateUpwards(parent);
+    while(newNode->parent != &head && newNode->parent->priority < newNode->priority)
+      rotateUp(newNode);
+    inserted = true;
+    return newNode;
+  }
+
+public:
+  explicit AugmentedTreeMap(const Monoid& monoid_ = Monoid()) : size(0), monoid(monoid_)
+  {}
+
+  AugmentedTreeMap(std::initializer_list<value_type> list) : AugmentedTreeMap()
+  {
+    for(auto& element : list)
+      set(element.first, element.second);
+  }
+
+  AugmentedTreeMap(const AugmentedTreeMap& other)
+    : size(other.size), priorities(other.priorities), monoid(other.monoid)
+  {
+    head.left = clone(other.head.left, &head);
+  }
+
+  AugmentedTreeMap(AugmentedTreeMap&& other) : priorities(other.priorities), monoid(other.monoid)
+  {
+    steal(other);
+  }
+
+  ~AugmentedTreeMap()
+  {
+    clear();
+  }
+
+  AugmentedTreeMap& operator=(const AugmentedTreeMap& other)
+  {
+    if(this == &other)
+      return *this;
+    Node* copy = clone(other.head.left, &head);
+    clear();
+    head.left = copy;
+    size = other.size;
+    monoid = other.monoid;
+    return *this;
+  }
+
+  AugmentedTreeMap& operator=(AugmentedTreeMap&& other)
+  {
+    if(this == &other)
+      return *this;
+    clear();
+    steal(other);
+    monoid = other.monoid;
+    return *this;
+  }
+
+  void clear()
+  {
+    if(head.left != nullptr)
+      head.left->parent = nullptr;
+    destroy(head.left);
+    head.left = nullptr;
+    size = 0;
+  }
+
+  bool isEmpty() const
+  {
+    return head.left == nullptr;
+  }
+
+  size_type getSize() const
+  {
+    return size;
+  }
+
+  // Inserts key with value, or replaces the value if key is present.
+  void set(const key_type& key, const mapped_type& value)
+  {
+    bool inserted;
+    Node* node = findOrInsert(key, value, inserted);
+    if(inserted)
+      return;
+    node->data.second = value;
+    updateUpwards(node);
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    if(isEmpty())
+      throw std::out_of_range("map is empty");
+    const_iterator position = find(key);
+    if(position == cend())
+      throw std::out_of_range("key does not exist");
+    return position->second;
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    return const_iterator(lookfor(key));
+  }
+
+  void remove(const key_type& key)
+  {
+    if(isEmpty())
+      throw std::out_of_range("cannot remove, empty list");
+    remove(find(key));
+  }
+
+  void remove(const const_iterator& it)
+  {
+    Node* removingNode = it.currentNode;
+    if(removingNode == &head)
+      throw std::out_of_range("cannot remove, no such element");
+    while(removingNode->left != nullptr && removingNode->right != nullptr)
+    {
+      if(removingNode->left->priority > removingNode->right->priority)
+        rotateUp(removingNode->left);
+      else
+        rotateUp(removingNode->right);
+    }
+    Node* son = removingNode->left != nullptr ? removingNode->left : removingNode->right;
+    Node* parent = removingNode->parent;
+    if(parent->left == removingNode)
+      parent->left = son;
+    else
+      parent->right = son;
+    if(son != nullptr)
+      son->parent = parent;
+    size--;
+    updateUpwards(parent);
+    delete removingNode;
+  }
+
+  // Product of all values in key order.
+  aggregate_type aggregate() const
+  {
+    return aggregateOf(head.left);
+  }
+
+  // Product of the values with keys in [first, last), in key order. Follows the two search paths
+  // for first and last below the node where they part, taking whole subtrees hanging inside.
+  aggregate_type aggregate(const key_type& first, const key_type& last) const
+  {
+    if(!(first < last))
+      return monoid.identity();
+    const Node* split = head.left;
+    while(split != nullptr && (split->data.first < first || !(split->data.first < last)))
+      split = split->data.first < first ? split->right : split->left;
+    if(split == nullptr)
+      return monoid.identity();
+
+    // items of the left subtree not below first, collected back to front.
+    aggregate_type below = monoid.identity();
+    for(const Node* node = split->left; node != nullptr;)
+    {
+      if(node->data.first < first)
+        node = node->right;
+      else
+      {
+        below = monoid(monoid(measure(node->data.second), aggregateOf(node->right)), below);
+        node = node->left;
+      }
+    }
+    // items of the right subtree below last, collected front to back.
+    aggregate_type above = monoid.identity();
+    for(const Node* node = split->right; node != nullptr;)
+    {
+      if(node->data.first < last)
+      {
+        above = monoid(above, monoid(aggregateOf(node->left), measure(node->data.second)));
+        node = node->right;
+      }
+      else
+        node = node->left;
+    }
+    return monoid(monoid(below, measure(split->data.second)), above);
+  }
+
+  bool operator==(const AugmentedTreeMap& other) const
+  {
+    if(getSize() != other.getSize())
+      return false;
+    for(auto thisIt = begin(), otherIt = other.begin(); thisIt != end(); ++thisIt, ++otherIt)
+      if(!(otherIt->first == thisIt->first && otherIt->second == thisIt->second))
+        return false;
+    return true;
+  }
+
+  bool operator!=(const AugmentedTreeMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  const_iterator cbegin() const
+  {
+    if(isEmpty())
+      return cend();
+    Node* searching = head.left;
+    while(searching->left != nullptr)
+      searching = searching->left;
+    return const_iterator(searching);
+  }
+
+  const_iterator cend() const
+  {
+    return const_iterator(sentinel());
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Monoid>
+class AugmentedTreeMap<KeyType, ValueType, Monoid>::ConstIterator
+{
+public:
+  using reference = typename AugmentedTreeMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename AugmentedTreeMap::value_type;
+  using pointer = const typename AugmentedTreeMap::value_type*;
+  using difference_type = std::ptrdiff_t;
+
+  Node* currentNode;
+
+  explicit ConstIterator() : currentNode(nullptr)
+  {}
+
+  ConstIterator(Node* pointer) : currentNode(pointer)
+  {}
+
+  ConstIterator& operator++()
+  {
+    // only the sentinel has no parent
+    if(currentNode->parent == nullptr)
+      throw std::out_of_range("cannot increment end");
+    if(currentNode->right != nullptr)
+    {
+      currentNode = currentNode->right;
+      while(currentNode->left != nullptr)
+        currentNode = currentNode->left;
+      return *this;
+    }
+    Node* nextNode = currentNode->parent;
+    while(currentNode == nextNode->right)
+    {
+      currentNode = nextNode;
+      nextNode = currentNode->parent;
+    }
+    currentNode = nextNode;
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    auto tmp = *this;
+    operator++();
+    return tmp;
+  }
+
+  ConstIterator& operator--()
+  {
+    if(currentNode->parent == nullptr)
+    {
+      if(currentNode->left == nullptr)
+        throw std::out_of_range("Cannot decrement, empty map");
+      currentNode = currentNode->left;
+      while(currentNode->right != nullptr)
+        currentNode = currentNode->right;
+      return *this;
+    }
+    if(currentNode->left != nullptr)
+    {
+      currentNode = currentNode->left;
+      while(currentNode->right != nullptr)
+        currentNode = currentNode->right;
+      return *this;
+    }
+    Node* nextNode = currentNode->parent;
+    while(nextNode->parent != nullptr && currentNode == nextNode->left)
+    {
+      currentNode = nextNode;
+      nextNode = currentNode->parent;
+    }
+    if(nextNode->parent == nullptr)
+      throw std::out_of_range("Cannot decrement begin");
+    currentNode = nextNode;
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    auto tmp = *this;
+    operator--();
+    return tmp;
+  }
+
+  reference operator*() const
+  {
+    if(currentNode->parent == nullptr)
+      throw std::out_of_range("Cannot dereference end");
+    return currentNode->data;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return this->currentNode == other.currentNode;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_AUGMENTEDTREEMAP_H */
@@ -0,0 +1,194 @@
+#ifndef AISDI_MAPS_BLOOMFILTER_H
+#define AISDI_MAPS_BLOOMFILTER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace aisdi
+{
+
+// Blocked Bloom filter: a key sets and tests one bit in each of the eight 32 bit words of a single
+// 32 byte block, so a lookup reads one cache line however many bits it checks. With AVX2 the eight
+// words are handled in one go. Keys cannot be taken out, the owner counts removals and rebuilds
+// the filter from its keys once needsRebuild() says so. Sized at 16 bits per key, about 0.1%
+// of misses get through.
+template <typename Key, typename Hash = std::hash<Key>>
+class BloomFilter
+{
+public:
+  BloomFilter() : mask(0), capacity(0), removed(0)
+  {}
+
+  // The blocks may sit at another offset of the copied storage, so they are copied one by one.
+  BloomFilter(const BloomFilter& other)
+    : storage(other.storage.size()), mask(other.mask), capacity(other.capacity), removed(other.removed)
+  {
+    if(other.isEnabled())
+      std::copy(other.blocks(), other.blocks() + mask + 1, blocks());
+  }
+
+  BloomFilter(BloomFilter&&) = default;
+
+  BloomFilter& operator=(const BloomFilter& other)
+  {
+    BloomFilter copy(other);
+    return *this = std::move(copy);
+  }
+
+  BloomFilter& operator=(BloomFilter&&) = default;
+
+  bool isEnabled() const
+  {
+    return !storage.empty();
+  }
+
+  // Empties the filter and sizes it for keys.
+  void reset(std::size_t keys)
+  {
+    std::size_t blocks = 1;
+    while(blocks * BITS_PER_BLOCK < keys * BITS_PER_KEY)
+      blocks *= 2;
+    // one spare block makes room to align the others.
+    storage.assign(blocks + 1, Block());
+    mask = blocks - 1;
+    capacity = blocks * BITS_PER_BLOCK / BITS_PER_KEY;
+    removed = 0;
+  }
+
+  // Drops the bits, the filter is disabled until the next reset.
+  void release()
+  {
+    std::vector<Block>().swap(storage);
+    mask = capacity = removed = 0;
+  }
+
+  void insert(const Key& key)
+  {
+    std::uint64_t hash = hashOf(key);
+    Block& block = blocks()[(hash >> 32) & mask];
+#ifdef __AVX2__
+    __m256i* words = reinterpret_cast<__m256i*>(block.words);
+    _mm256_store_si256(words, _mm256_or_si256(_mm256_load_si256(words), bitsOf(hash)));
+#else
+    for(std::size_t i = 0; i < WORDS; ++i)
+      block.words[i] |= bitOf(hash, i);
+#endif
+  }
+
+  // False means key was never inserted, true that it probably was.
+  bool mayContain(const Key& key) const
+  {
+    std::uint64_t hash = hashOf(key);
+    const Block& block = blocks()[(hash >> 32) & mask];
+#ifdef __AVX2__
+    return _mm256_testc_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(block.words)), bitsOf(hash)) != 0;
+#else
+    std::uint32_t missing = 0;
+    for(std::size_t i = 0; i < WORDS; ++i)
+      missing |= bitOf(hash, i) & ~block.words[i];
+    return missing == 0;
+#endif
+  }
+
+  // The bits of a removed key stay set, they only count towards a rebuild.
+  void noteRemoval()
+  {
+    removed++;
+  }
+
+  // True once the owner holds more keys than the filter was sized for, or removed more than it holds.
+  bool needsRebuild(std::size_t keys) const
+  {
+    return keys > capacity || removed > keys;
+  }
+
+  std::size_t getCapacity() const
+  {
+    return capacity;
+  }
+
+private:
+  static const std::size_t WORDS = 8;
+  static const std::size_t BITS_PER_BLOCK = 256;
+  static const std::size_t BITS_PER_KEY = 16;
+
+  struct Block
+  {
+    std::uint32_t words[WORDS];
+  };
+
+  std::vector<Block> storage;
+  std::size_t mask;
+  std::size_t capacity;
+  std::size_t removed;
+
+  // Odd multipliers giving each word its own bit out of the low half of the hash.
+  static const std::uint32_t* salts()
+  {
+    static const std::uint32_t values[WORDS] = { 0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                                 0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U };
+    return values;
+  }
+
+  // Blocks start on a 32 byte boundary, so none of them straddles two cache lines.
+  Block* blocks()
+  {
+    auto address = reinterpret_cast<std::uintptr_t>(storage.data());
+    return reinterpret_cast<Block*>((address + sizeof(Block) - 1) & ~std::uintptr_t(sizeof(Block) - 1));
+  }
+
+  const Block* blocks() const
+  {
+    return const_cast<BloomFilter*>(this)->blocks();
+  }
+
+  // Lets containers of keys without a hash compile, as long as they never turn their filter on.
+  static std::uint64_t rawHash(const Key& key, std::true_type)
+  {
+    return static_cast<std::uint64_t>(Hash{}(key));
+  }
+
+  static std::uint64_t rawHash(const Key&, std::false_type)
+  {
+    return 0;
+  }
+
+  // Spreads the bits of hashes that are poor on their own, like the identity of integers.
+  static std::uint64_t hashOf(const Key& key)
+  {
+    std::uint64_t hash = rawHash(key, std::is_default_constructible<Hash>());
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+  }
+
+  static std::uint32_t bitOf(std::uint64_t hash, std::size_t word)
+  {
+    return std::uint32_t(1) << ((static_cast<std::uint32_t>(hash) * salts()[word]) >> 27);
+  }
+
+#ifdef __AVX2__
+  static __m256i bitsOf(std::uint64_t hash)
+  {
+    const __m256i salt = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(salts()));
+    __m256i shifts = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(hash)), salt), 27);
+    return _mm256_sllv_epi32(_mm256_set1_epi32(1), shifts);
+  }
+#endif
+};
+
+}
+
+#endif /* AISDI_MAPS_BLOOMFILTER_H */
@@ -0,0 +1,741 @@
+#ifndef AISDI_MAPS_COMPACTTREEMAP_H
+#define AISDI_MAPS_COMPACTTREEMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Compare.h"
+
+namespace aisdi
+{
+
+// Red-black tree whose nodes live in one array and link to each other by 32-bit indices, with the
+// color kept in the top bit of the parent index. Index 0 is the black nil node, standing for missing
+// children and for end(). Values sit in a parallel array, so a node is just the key and 12 bytes of
+// links: 16 bytes for int keys, where a pointer based node spends 24 bytes on links alone. Searches
+// touch only the key array. Removal moves the last node into the freed slot to keep the arrays
+// dense, which invalidates iterators to that node as well.
+template <typename KeyType, typename ValueType, typename Compare = std::less<KeyType>>
+class CompactTreeMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = std::pair<const key_type&, mapped_type&>;
+  using const_reference = std::pair<const key_type&, const mapped_type&>;
+  using key_compare = Compare;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+private:
+  using Index = std::uint32_t;
+
+  static const Index NIL = 0;
+  static const Index RED = Index(1) << 31;
+  static const Index INDEX = RED - 1;
+
+  struct Node
+  {
+    key_type key;
+    Index left, right;
+    // parent index, top bit set for red nodes.
+    Index parent;
+
+    Node() : key(), left(NIL), right(NIL), parent(NIL)
+    {}
+    Node(const key_type& key_, Index parent_) : key(key_), left(NIL), right(NIL), parent(parent_ | RED)
+    {}
+  };
+
+  using KeyOrder = KeyCompare<Compare, key_type>;
+
+  // Both indexed by node index, slot 0 holds nil.
+  std::vector<Node> nodes;
+  std::vector<mapped_type> values;
+  Index root;
+  Compare comp;
+
+  Index& left(Index node)
+  {
+    return nodes[node].left;
+  }
+
+  Index& right(Index node)
+  {
+    return nodes[node].right;
+  }
+
+  Index parent(Index node) const
+  {
+    return nodes[node].parent & INDEX;
+  }
+
+  void setParent(Index node, Index parent)
+  {
+    nodes[node].parent = (nodes[node].parent & RED) | parent;
+  }
+
+  bool isRed(Index node) const
+  {
+    return (nodes[node].parent & RED) != 0;
+  }
+
+  void setRed(Index node, bool red)
+  {
+    nodes[node].parent = red ? (nodes[node].parent | RED) : (nodes[node].parent & INDEX);
+  }
+
+  Index minimum(Index node) const
+  {
+    while(nodes[node].left != NIL)
+      node = nodes[node].left;
+    return node;
+  }
+
+  Index maximum(Index node) const
+  {
+    while(nodes[node].right != NIL)
+      node = nodes[node].right;
+    return node;
+  }
+
+  Index successor(Index node) const
+  {
+    if(nodes[node].right != NIL)
+      return minimum(nodes[node].right);
+    Index above = parent(node);
+    while(above != NIL && node == nodes[above].right)
+    {
+      node = above;
+      above = parent(node);
+    }
+    return above;
+  }
+
+  Index predecessor(Index node) const
+  {
+    if(nodes[node].left != NIL)
+      return maximum(nodes[node].left);
+    Index above = parent(node);
+    while(above != NIL && node == nodes[above].left)
+    {
+      node = above;
+      above = parent(node);
+    }
+    return above;
+  }
+
+  // Puts replacement where node hangs, nil included, since removal fix-up starts from its parent.
+  void transplant(Index node, Index replacement)
+  {
+    Index above = parent(node);
+    if(above == NIL)
+      root = replacement;
+    else if(node == left(above))
+      left(above) = replacement;
+    else
+      right(above) = replacement;
+    setParent(replacement, above);
+  }
+
+  void rotateLeft(Index node)
+  {
+    Index child = right(node);
+    right(node) = left(child);
+    if(left(child) != NIL)
+      setParent(left(child), node);
+    transplant(node, child);
+    left(child) = node;
+    setParent(node, child);
+  }
+
+  void rotateRight(Index node)
+  {
+    Index child = left(node);
+    left(node) = right(child);
+    if(right(child) != NIL)
+      setParent(right(child), node);
+    transplant(node, child);
+    right(child) = node;
+    setParent(node, child);
+  }
+
+  Index lookfor(const key_type& key) const
+  {
+    Index current = root;
+    while(current != NIL)
+    {
+      int order = KeyOrder::compare(comp, key, nodes[current].key);
+      if(order == 0)
+        return current;
+      current = order < 0 ? nodes[current].left : nodes[current].right;
+    }
+    return NIL;
+  }
+
+  Index insert(const key_type& key)
+  {
+    Index above = NIL;
+    Index current = root;
+    int order = 0;
+    while(current != NIL)
+    {
+      order = KeyOrder::compare(comp, key, nodes[current].key);
+      if(order == 0)
+        return current;
+      above = current;
+      current = order < 0 ? nodes[current].left : nodes[current].right;
+    }
+
+    if(nodes.empty())
+    {
+      // a moved-from map gets its sentinel back.
+      nodes.resize(1);
+      values.resize(1);
+    }
+    if(nodes.size() > INDEX)
+      throw std::length_error("map is full");
+    Index created = static_cast<Index>(nodes.size());
+    nodes.emplace_back(key, above);
+    try
+    {
+      values.emplace_back();
+    }
+    catch(...)
+    {
+      nodes.pop_back();
+      throw;
+    }
+    if(above == NIL)
+      root = created;
+    else if(order < 0)
+      left(above) = created;
+    else
+      right(above) = created;
+    fixAfterInsert(created);
+    return created;
+  }
+
+  void fixAfterInsert(Index node)
+  {
+    while(isRed(parent(node)))
+    {
+      Index above = parent(node);
+      Index grandparent = parent(above);
+      if(above == left(grandparent))
+      {
+        Index uncle = right(grandparent);
+        if(isRed(uncle))
+        {
+          setRed(above, false);
+          setRed(uncle, false);
+          setRed(grandparent, true);
+          node = grandparent;
+          continue;
+        }
+        if(node == right(above))
+        {
+          node = above;
+          rotateLeft(node);
+          above = parent(node);
+        }
+        setRed(above, false);
+        setRed(grandparent, true);
+        rotateRight(grandparent);
+      }
+      else
+      {
+        Index uncle = left(grandparent);
+        if(isRed(uncle))
+        {
+          setRed(above, false);
+          setRed(uncle, false);
+          setRed(grandparent, true);
+          node = grandparent;
+          continue;
+        }
+        if(node == left(above))
+        {
+          node = above;
+          rotateRight(node);
+          above = parent(node);
+        }
+        setRed(above, false);
+        setRed(grandparent, true);
+        rotateLeft(grandparent);
+      }
+    }
+    setRed(root, false);
+  }
+
+  void erase(Index node)
+  {
+    Index moved = node;
+    bool movedWasRed = isRed(moved);
+    Index replacement;
+    if(left(node) == NIL)
+    {
+      replacement = right(node);
+      transplant(node, replacement);
+    }
+    else if(right(node) == NIL)
+    {
+      replacement = left(node);
+      transplant(node, replacement);
+    }
+    else
+    {
+      moved = minimum(right(node));
+      movedWasRed = isRed(moved);
+      replacement = right(moved);
+      if(parent(moved) == node)
+        setParent(replacement, moved);
+      else
+      {
+        transplant(moved, replacement);
+        right(moved) = right(node);
+        setParent(right(moved), moved);
+      }
+      transplant(node, moved);
+      left(moved) = left(node);
+      setParent(left(moved), moved);
+      setRed(moved, isRed(node));
+    }
+    if(!movedWasRed)
+      fixAfterErase(replacement);
+    release(node);
+  }
+
+  void fixAfterErase(Index node)
+  {
+    while(node != root && !isRed(node))
+    {
+      Index above = parent(node);
+      if(node == left(above))
+      {
+        Index sibling = right(above);
+        if(isRed(sibling))
+        {
+          setRed(sibling, false);
+          setRed(above, true);
+          rotateLeft(above);
+          sibling = right(above);
+        }
+        if(!isRed(left(sibling)) && !isRed(right(sibling)))
+        {
+          setRed(sibling, true);
+          node = above;
+          continue;
+        }
+        if(!isRed(right(sibling)))
+        {
+          setRed(left(sibling), false);
+          setRed(sibling, true);
+          rotateRight(sibling);
+          sibling = right(above);
+        }
+        setRed(sibling, isRed(above));
+        setRed(above, false);
+        setRed(right(sibling), false);
+        rotateLeft(above);
+      }
+      else
+      {
+        Index sibling = left(above);
+        if(isRed(sibling))
+        {
+          setRed(sibling, false);
+          setRed(above, true);
+          rotateRight(above);
+          sibling = left(above);
+        }
+        if(!isRed(left(sibling)) && !isRed(right(sibling)))
+        {
+          setRed(sibling, true);
+          node = above;
+          continue;
+        }
+        if(!isRed(left(sibling)))
+        {
+          setRed(right(sibling), false);
+          setRed(sibling, true);
+          rotateLeft(sibling);
+          sibling = left(above);
+        }
+        setRed(sibling, isRed(above));
+        setRed(above, false);
+        setRed(left(sibling), false);
+        rotateRight(above);
+      }
+      node = root;
+    }
+    setRed(node, false);
+  }
+
+  // Frees the slot of an unlinked node by moving the last node into it.
+  void release(Index freed)
+  {
+    Index last = static_cast<Index>(nodes.size() - 1);
+    if(freed != last)
+    {
+      nodes[freed] = std::move(nodes[last]);
+      values[freed] = std::move(values[last]);
+      Index above = parent(freed);
+      if(above == NIL)
+        root = freed;
+      else if(left(above) == last)
+        left(above) = freed;
+      else
+        right(above) = freed;
+      if(left(freed) != NIL)
+        setParent(left(freed), freed);
+      if(right(freed) != NIL)
+        setParent(right(freed), freed);
+    }
+    nodes.pop_back();
+    values.pop_back();
+  }
+
+public:
+  explicit CompactTreeMap(const Compare& comparator = Compare()) : nodes(1), values(1), root(NIL), comp(comparator)
+  {}
+
+  CompactTreeMap(std::initializer_list<value_type> list) : CompactTreeMap()
+  {
+    for(auto& element : list)
+      operator[](element.first) = element.second;
+  }
+
+  CompactTreeMap(const CompactTreeMap& other) = default;
+  CompactTreeMap& operator=(const CompactTreeMap& other) = default;
+
+  // The arrays are taken over, the moved-from map is left without even the sentinel slot.
+  CompactTreeMap(CompactTreeMap&& other) noexcept
+    : nodes(std::move(other.nodes)), values(std::move(other.values)), root(other.root), comp(other.comp)
+  {
+    other.nodes.clear();
+    other.values.clear();
+    other.root = NIL;
+  }
+
+  CompactTreeMap& operator=(CompactTreeMap&& other) noexcept
+  {
+    if(this == &other)
+      return *this;
+    nodes = std::move(other.nodes);
+    values = std::move(other.values);
+    root = other.root;
+    comp = other.comp;
+    other.nodes.clear();
+    other.values.clear();
+    other.root = NIL;
+    return *this;
+  }
+
+  bool isEmpty() const
+  {
+    return root == NIL;
+  }
+
+  size_type getSize() const
+  {
+    return nodes.empty() ? 0 : nodes.size() - 1;
+  }
+
+  void clear()
+  {
+    nodes.resize(1);
+    values.resize(1);
+    nodes[NIL] = Node();
+    root = NIL;
+  }
+
+  // Makes room for count items, so inserting them does not move the arrays.
+  void reserve(size_type count)
+  {
+    nodes.reserve(count + 1);
+    values.reserve(count + 1);
+  }
+
+  key_compare key_comp() const
+  {
+    return comp;
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    return values[insert(key)];
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    if(isEmpty())
+      throw std::out_of_range("map is empty");
+    Index found = lookfor(key);
+    if(found == NIL)
+      throw std::out_of_range("key does not exist");
+    return values[found];
+  }
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    return const_cast<mapped_type&>(static_cast<const CompactTreeMap*>(this)->valueOf(key));
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    return const_iterator(this, lookfor(key));
+  }
+
+  iterator find(const key_type& key)
+  {
+    return static_cast<const CompactTreeMap*>(this)->find(key);
+  }
+
+  void remove(const key_type& key)
+  {
+    if(isEmpty())
+      throw std::out_of_range("cannot remove, empty list");
+    Index found = lookfor(key);
+    if(found == NIL)
+      throw std::out_of_range("cannot remove, no such element");
+    erase(found);
+  }
+
+  void remove(const const_iterator& it)
+  {
+    if(it.index == NIL)
+      throw std::out_of_range("cannot remove, no such element");
+    erase(it.index);
+  }
+
+  bool operator==(const CompactTreeMap& other) const
+  {
+    if(getSize() != other.getSize())
+      return false;
+    for(auto thisIt = begin(), otherIt = other.begin(); thisIt != end(); ++thisIt, ++otherIt)
+      if(!(thisIt->first == otherIt->first && thisIt->second == otherIt->second))
+        return false;
+    return true;
+  }
+
+  bool operator!=(const CompactTreeMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  iterator begin()
+  {
+    return cbegin();
+  }
+
+  iterator end()
+  {
+    return cend();
+  }
+
+  const_iterator cbegin() const
+  {
+    return const_iterator(this, isEmpty() ? NIL : minimum(root));
+  }
+
+  const_iterator cend() const
+  {
+    return const_iterator(this, NIL);
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Compare>
+const typename CompactTreeMap<KeyType, ValueType, Compare>::Index CompactTreeMap<KeyType, ValueType, Compare>::NIL;
+
+template <typename KeyType, typename ValueType, typename Compare>
+const typename CompactTreeMap<KeyType, ValueType, Compare>::Index CompactTreeMap<KeyType, ValueType, Compare>::RED;
+
+template <typename KeyType, typename ValueType, typename Compare>
+const typename CompactTreeMap<KeyType, ValueType, Compare>::Index CompactTreeMap<KeyType, ValueType, Compare>::INDEX;
+
+// Keys and values are kept apart, so dereferencing yields a pair of references rather than a
+// reference to a stored pair, and operator-> goes through a small proxy holding that pair.
+template <typename KeyType, typename ValueType, typename Compare>
+class CompactTreeMap<KeyType, ValueType, Compare>::ConstIterator
+{
+public:
+  using reference = typename CompactTreeMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename CompactTreeMap::value_type;
+  using difference_type = std::ptrdiff_t;
+
+  class pointer
+  {
+  public:
+    explicit pointer(reference item_) : item(item_)
+    {}
+
+    const reference* operator->() const
+    {
+      return &item;
+    }
+
+  private:
+    reference item;
+  };
+
+  explicit ConstIterator() : map(nullptr), index(NIL)
+  {}
+
+  ConstIterator(const CompactTreeMap* map_, Index index_) : map(map_), index(index_)
+  {}
+
+  ConstIterator& operator++()
+  {
+    if(index == NIL)
+      throw std::out_of_range("cannot increment end");
+    index = map->successor(index);
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    auto tmp = *this;
+    operator++();
+    return tmp;
+  }
+
+  ConstIterator& operator--()
+  {
+    if(map == nullptr || map->isEmpty())
+      throw std::out_of_range("Cannot decrement, empty map");
+    Index previous = index == NIL ? map->maximum(map->root) : map->predecessor(index);
+    if(previous == NIL)
+      throw std::out_of_range("Cannot decrement begin");
+    index = previous;
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    auto tmp = *this;
+    operator--();
+    return tmp;
+  }
+
+  reference operator*() const
+  {
+    if(index == NIL)
+      throw std::out_of_range("Cannot dereference end");
+    return reference(map->nodes[index].key, map->values[index]);
+  }
+
+  pointer operator->() const
+  {
+    return pointer(this->operator*());
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return index == other.index;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+
+protected:
+  friend class CompactTreeMap;
+
+  const CompactTreeMap* map;
+  Index index;
+};
+
+template <typename KeyType, typename ValueType, typename Compare>
+class CompactTreeMap<KeyType, ValueType, Compare>::Iterator : public CompactTreeMap<KeyType, ValueType, Compare>::ConstIterator
+{
+public:
+  using reference = typename CompactTreeMap::reference;
+
+  class pointer
+  {
+  public:
+    explicit pointer(reference item_) : item(item_)
+    {}
+
+    const reference* operator->() const
+    {
+      return &item;
+    }
+
+  private:
+    reference item;
+  };
+
+  explicit Iterator()
+  {}
+
+  Iterator(const ConstIterator& other)
+    : ConstIterator(other)
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const
+  {
+    return pointer(this->operator*());
+  }
+
+  reference operator*() const
+  {
+    auto item = ConstIterator::operator*();
+    // ugly cast, yet reduces code duplication.
+    return reference(item.first, const_cast<mapped_type&>(item.second));
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_COMPACTTREEMAP_H */
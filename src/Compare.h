@@ -0,0 +1,84 @@
+#ifndef AISDI_MAPS_COMPARE_H
+#define AISDI_MAPS_COMPARE_H
+
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace aisdi
+{
+
+namespace detail
+{
+
+template <typename Compare, typename Key>
+class HasCompareMember
+{
+  template <typename C>
+  static auto test(int) -> decltype(static_cast<int>(std::declval<const C&>().compare(std::declval<const Key&>(),
+                                                                                     std::declval<const Key&>())),
+                                    std::true_type());
+  template <typename>
+  static std::false_type test(...);
+
+public:
+  static const bool value = decltype(test<Compare>(0))::value;
+};
+
+}
+
+// Three-way comparison of keys under the ordering Compare, returning a negative, zero or positive
+// number like strcmp. A comparator may provide int compare(a, b) itself, std::less gets one for
+// strings (a single pass over the characters) and for arithmetic keys. threeWay is false when the
+// ordering only offers less-than, such descents rather compare once per level and check equality
+// at the bottom.
+template <typename Compare, typename Key, typename Enable = void>
+struct KeyCompare
+{
+  static const bool threeWay = false;
+
+  static int compare(const Compare& less, const Key& left, const Key& right)
+  {
+    return less(left, right) ? -1 : (less(right, left) ? 1 : 0);
+  }
+};
+
+template <typename Compare, typename Key>
+struct KeyCompare<Compare, Key, typename std::enable_if<detail::HasCompareMember<Compare, Key>::value>::type>
+{
+  static const bool threeWay = true;
+
+  static int compare(const Compare& comparator, const Key& left, const Key& right)
+  {
+    return comparator.compare(left, right);
+  }
+};
+
+template <typename Key>
+struct KeyCompare<std::less<Key>, Key, typename std::enable_if<std::is_arithmetic<Key>::value>::type>
+{
+  static const bool threeWay = true;
+
+  static int compare(const std::less<Key>&, const Key& left, const Key& right)
+  {
+    return (right < left) - (left < right);
+  }
+};
+
+template <typename Char, typename Traits, typename Alloc>
+struct KeyCompare<std::less<std::basic_string<Char, Traits, Alloc>>, std::basic_string<Char, Traits, Alloc>>
+{
+  static const bool threeWay = true;
+
+  static int compare(const std::less<std::basic_string<Char, Traits, Alloc>>&,
+                     const std::basic_string<Char, Traits, Alloc>& left,
+                     const std::basic_string<Char, Traits, Alloc>& right)
+  {
+    return left.compare(right);
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_COMPARE_H */
@@ -0,0 +1,645 @@
+#ifndef AISDI_MAPS_CONCURRENTSKIPLISTMAP_H
+#define AISDI_MAPS_CONCURRENTSKIPLISTMAP_H
+
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace aisdi
+{
+
+namespace detail
+{
+
+// Epoch based reclamation. Every reader announces the global epoch in a slot before touching shared
+// nodes; the epoch only moves on once all announced readers have caught up with it. A node retired
+// in epoch e cannot be reached by anyone once the global epoch is e + 2, so it is freed then.
+class EpochDomain
+{
+public:
+  static const unsigned SLOTS = 128;
+  static const unsigned INACTIVE = UINT_MAX;
+
+  class Guard
+  {
+  public:
+    explicit Guard(EpochDomain& domain_) : domain(&domain_), slot(domain_.enter())
+    {}
+
+    ~Guard()
+    {
+      domain->leave(slot);
+    }
+
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+  private:
+    EpochDomain* domain;
+    unsigned slot;
+  };
+
+  EpochDomain() : epoch(0)
+  {
+    for(auto& slot : slots)
+    {
+      slot.claimed.store(false, std::memory_order_relaxed);
+      slot.epoch.store(INACTIVE, std::memory_order_relaxed);
+    }
+  }
+
+  unsigned current() const
+  {
+    return epoch.load();
+  }
+
+  // Moves the epoch on if every active reader has announced the current one, returns the epoch.
+  unsigned advance()
+  {
+    unsigned observed = epoch.load();
+    for(auto& slot : slots)
+    {
+      unsigned announced = slot.epoch.load();
+      if(announced != INACTIVE && announced != observed)
+        return observed;
+    }
+    epoch.compare_exchange_strong(observed, observed + 1);
+    return epoch.load();
+  }
+
+  static bool expired(unsigned retiredIn, unsigned now)
+  {
+    return now - retiredIn >= 2;
+  }
+
+private:
+  struct alignas(64) Slot
+  {
+    std::atomic<bool> claimed;
+    std::atomic<unsigned> epoch;
+  };
+
+  std::atomic<unsigned> epoch;
+  Slot slots[SLOTS];
+
+  unsigned enter()
+  {
+    unsigned start = static_cast<unsigned>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    for(unsigned i = 0;; ++i)
+    {
+      unsigned index = (start + i) % SLOTS;
+      bool expected = false;
+      if(slots[index].claimed.compare_exchange_weak(expected, true))
+      {
+        unsigned announced;
+        do
+        {
+          announced = epoch.load();
+          slots[index].epoch.store(announced);
+        } while(epoch.load() != announced);
+        return index;
+      }
+      if(i % SLOTS == SLOTS - 1)
+        std::this_thread::yield();
+    }
+  }
+
+  void leave(unsigned index)
+  {
+    slots[index].epoch.store(INACTIVE);
+    slots[index].claimed.store(false);
+  }
+};
+
+}
+
+// Lock-free ordered map built as a skip list (Herlihy, Lev, Luchangco, Shavit). Every level is
+// a sorted list linked with compare-and-swap; a node is deleted by setting the low bit of its
+// next pointers, which freezes them, and unlinked by whoever walks past it next. Removed nodes
+// are freed through epoch based reclamation, so readers never touch released memory.
+// Lookups, inserts and removals may run from any number of threads. Iteration is weakly
+// consistent: it sees every item present for its whole duration and maybe some concurrent ones.
+// Values are published with their node and never changed afterwards, hence no operator[].
+template <typename KeyType, typename ValueType>
+class ConcurrentSkipListMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = const value_type&;
+  using const_reference = const value_type&;
+
+  class ConstIterator;
+  using iterator = ConstIterator;
+  using const_iterator = ConstIterator;
+
+private:
+  static const int MAX_LEVEL = 24;
+  static const std::uintptr_t MARK = 1;
+
+  using Link = std::atomic<std::uintptr_t>;
+  using Guard = detail::EpochDomain::Guard;
+
+  struct Node
+  {
+    value_type data;
+    int height;
+    Link* next;
+    // The inserter and the remover both drop one reference, the node is retired
+    // only after both of them are done linking and unlinking it. Iterators hold one too.
+    std::atomic<int> owners;
+    Node* retiredNext;
+    unsigned retiredIn;
+
+    Node(int height_) : data(), height(height_), next(new Link[height_]), owners(2)
+    {}
+    Node(const key_type& key, const mapped_type& value, int height_)
+      : data(key, value), height(height_), next(new Link[height_]), owners(2)
+    {}
+    ~Node()
+    {
+      delete[] next;
+    }
+  };
+
+  static Node* pointer(std::uintptr_t link)
+  {
+    return reinterpret_cast<Node*>(link & ~MARK);
+  }
+
+  static std::uintptr_t linkTo(Node* node)
+  {
+    return reinterpret_cast<std::uintptr_t>(node);
+  }
+
+  static bool isMarked(std::uintptr_t link)
+  {
+    return (link & MARK) != 0;
+  }
+
+  mutable detail::EpochDomain domain;
+  Node* head;
+  std::atomic<size_type> size;
+  mutable std::atomic<Node*> retired;
+  mutable std::atomic<unsigned> retiredCount;
+
+  static int randomHeight()
+  {
+    static thread_local std::uint32_t state =
+      static_cast<std::uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    int height = 1;
+    for(std::uint32_t bits = state; (bits & 1u) != 0 && height < MAX_LEVEL; bits >>= 1)
+      height++;
+    return height;
+  }
+
+  // Fills preds and succs with the neighbours of key on every level, unlinking marked nodes
+  // on the way. Returns true if an unmarked node holding key is linked on the bottom level.
+  bool lookfor(const key_type& key, Node** preds, Node** succs)
+  {
+  retry:
+    Node* pred = head;
+    for(int level = MAX_LEVEL - 1; level >= 0; --level)
+    {
+      Node* current = pointer(pred->next[level].load());
+      while(current != nullptr)
+      {
+        std::uintptr_t successor = current->next[level].load();
+        if(isMarked(successor))
+        {
+          std::uintptr_t expected = linkTo(current);
+          if(!pred->next[level].compare_exchange_strong(expected, successor & ~MARK))
+            goto retry;
+          current = pointer(successor);
+          continue;
+        }
+        if(!(current->data.first < key))
+          break;
+        pred = current;
+        current = pointer(successor);
+      }
+      preds[level] = pred;
+      succs[level] = current;
+    }
+    return succs[0] != nullptr && !(key < succs[0]->data.first);
+  }
+
+  // Read-only search skipping over marked nodes. Returns the first live node with key not less than key.
+  Node* lowerNode(const key_type& key) const
+  {
+    Node* pred = head;
+    Node* current = nullptr;
+    for(int level = MAX_LEVEL - 1; level >= 0; --level)
+    {
+      current = pointer(pred->next[level].load());
+      while(current != nullptr)
+      {
+        std::uintptr_t successor = current->next[level].load();
+        if(isMarked(successor))
+        {
+          current = pointer(successor);
+          continue;
+        }
+        if(!(current->data.first < key))
+          break;
+        pred = current;
+        current = pointer(successor);
+      }
+    }
+    return current;
+  }
+
+  static Node* liveSuccessor(Node* node)
+  {
+    Node* current = pointer(node->next[0].load());
+    while(current != nullptr && isMarked(current->next[0].load()))
+      current = pointer(current->next[0].load());
+    return current;
+  }
+
+  // Takes a reference on the first node from node on that is not retired yet, so an iterator can
+  // keep it without pinning the epoch. Must be called under a guard.
+  static Node* acquireFrom(Node* node)
+  {
+    while(node != nullptr)
+    {
+      int owners = node->owners.load();
+      while(owners > 0 && !node->owners.compare_exchange_weak(owners, owners + 1))
+        ;
+      if(owners > 0)
+        return node;
+      node = liveSuccessor(node);
+    }
+    return nullptr;
+  }
+
+  // First live node with key greater than key, for iterators whose node got removed.
+  Node* upperNode(const key_type& key) const
+  {
+    Node* node = lowerNode(key);
+    if(node != nullptr && !(key < node->data.first))
+      node = liveSuccessor(node);
+    return node;
+  }
+
+  void release(Node* node) const
+  {
+    if(node->owners.fetch_sub(1) != 1)
+      return;
+    node->retiredIn = domain.current();
+    Node* top = retired.load();
+    do
+      node->retiredNext = top;
+    while(!retired.compare_exchange_weak(top, node));
+    if(retiredCount.fetch_add(1) % 64 == 63)
+      reclaim();
+  }
+
+  void reclaim() const
+  {
+    // Take the list first: every node on it was then retired no later than now.
+    Node* list = retired.exchange(nullptr);
+    const unsigned now = domain.advance();
+    Node* keep = nullptr;
+    Node* keepTail = nullptr;
+    while(list != nullptr)
+    {
+      Node* node = list;
+      list = list->retiredNext;
+      if(detail::EpochDomain::expired(node->retiredIn, now))
+      {
+        delete node;
+        continue;
+      }
+      node->retiredNext = keep;
+      if(keep == nullptr)
+        keepTail = node;
+      keep = node;
+    }
+    if(keep == nullptr)
+      return;
+    Node* top = retired.load();
+    do
+      keepTail->retiredNext = top;
+    while(!retired.compare_exchange_weak(top, keep));
+  }
+
+  void destroy()
+  {
+    Node* node = pointer(head->next[0].load());
+    while(node != nullptr)
+    {
+      Node* next = pointer(node->next[0].load());
+      delete node;
+      node = next;
+    }
+    for(node = retired.exchange(nullptr); node != nullptr;)
+    {
+      Node* next = node->retiredNext;
+      delete node;
+      node = next;
+    }
+    delete head;
+  }
+
+public:
+  ConcurrentSkipListMap() : head(new Node(MAX_LEVEL)), size(0), retired(nullptr), retiredCount(0)
+  {
+    for(int level = 0; level < MAX_LEVEL; ++level)
+      head->next[level].store(0, std::memory_order_relaxed);
+  }
+
+  ConcurrentSkipListMap(std::initializer_list<value_type> list) : ConcurrentSkipListMap()
+  {
+    for(auto& element : list)
+      insert(element.first, element.second);
+  }
+
+  // Copies a weakly consistent view of other.
+  ConcurrentSkipListMap(const ConcurrentSkipListMap& other) : ConcurrentSkipListMap()
+  {
+    for(auto it = other.begin(); it != other.end(); ++it)
+      insert(it->first, it->second);
+  }
+
+  ConcurrentSkipListMap& operator=(const ConcurrentSkipListMap&) = delete;
+
+  // Must not race with any other operation on the map.
+  ~ConcurrentSkipListMap()
+  {
+    destroy();
+  }
+
+  bool isEmpty() const
+  {
+    return size.load() == 0;
+  }
+
+  size_type getSize() const
+  {
+    return size.load();
+  }
+
+  // Returns false, leaving the map unchanged, when key is already present.
+  bool insert(const key_type& key, const mapped_type& value)
+  {
+    Guard guard(domain);
+    Node* preds[MAX_LEVEL];
+    Node* succs[MAX_LEVEL];
+    if(lookfor(key, preds, succs))
+      return false;
+
+    const int height = randomHeight();
+    Node* node = new Node(key, value, height);
+    while(true)
+    {
+      for(int level = 0; level < height; ++level)
+        node->next[level].store(linkTo(succs[level]), std::memory_order_relaxed);
+      std::uintptr_t expected = linkTo(succs[0]);
+      if(preds[0]->next[0].compare_exchange_strong(expected, linkTo(node)))
+        break;
+      if(lookfor(key, preds, succs))
+      {
+        delete node;
+        return false;
+      }
+    }
+    size.fetch_add(1);
+
+    for(int level = 1; level < height; ++level)
+    {
+      bool linked = false;
+      while(!linked)
+      {
+        std::uintptr_t own = node->next[level].load();
+        if(isMarked(own))
+          break;
+        if(pointer(own) != succs[level] && !node->next[level].compare_exchange_strong(own, linkTo(succs[level])))
+          break;
+        std::uintptr_t expected = linkTo(succs[level]);
+        linked = preds[level]->next[level].compare_exchange_strong(expected, linkTo(node));
+        if(!linked && (!lookfor(key, preds, succs) || succs[0] != node))
+          break;
+      }
+      if(!linked)
+        break;
+    }
+
+    // A remover may have marked the node while upper levels were being linked, sweep them out.
+    if(isMarked(node->next[0].load()))
+      lookfor(key, preds, succs);
+    release(node);
+    return true;
+  }
+
+  bool contains(const key_type& key) const
+  {
+    Guard guard(domain);
+    Node* node = lowerNode(key);
+    return node != nullptr && !(key < node->data.first);
+  }
+
+  mapped_type valueOf(const key_type& key) const
+  {
+    Guard guard(domain);
+    Node* node = lowerNode(key);
+    if(node == nullptr || key < node->data.first)
+      throw std::out_of_range("key does not exist");
+    return node->data.second;
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    const_iterator found = lowerBound(key);
+    if(found.currentNode == nullptr || key < found.currentNode->data.first)
+      return cend();
+    return found;
+  }
+
+  // First item with key not less than key.
+  const_iterator lowerBound(const key_type& key) const
+  {
+    Guard guard(domain);
+    return const_iterator(this, acquireFrom(lowerNode(key)));
+  }
+
+  // Calls fn for the items with keys in [first, last), in order.
+  template <typename Function>
+  void forEachInRange(const key_type& first, const key_type& last, Function fn) const
+  {
+    Guard guard(domain);
+    for(Node* node = lowerNode(first); node != nullptr && node->data.first < last; node = liveSuccessor(node))
+      fn(static_cast<const value_type&>(node->data));
+  }
+
+  void remove(const key_type& key)
+  {
+    Guard guard(domain);
+    Node* preds[MAX_LEVEL];
+    Node* succs[MAX_LEVEL];
+    if(!lookfor(key, preds, succs))
+      throw std::out_of_range("cannot remove, no such element");
+
+    Node* victim = succs[0];
+    for(int level = victim->height - 1; level > 0; --level)
+    {
+      std::uintptr_t link = victim->next[level].load();
+      while(!isMarked(link) && !victim->next[level].compare_exchange_weak(link, link | MARK))
+        ;
+    }
+    std::uintptr_t link = victim->next[0].load();
+    while(true)
+    {
+      if(isMarked(link))
+        throw std::out_of_range("cannot remove, no such element");
+      if(victim->next[0].compare_exchange_weak(link, link | MARK))
+        break;
+    }
+    size.fetch_sub(1);
+    lookfor(key, preds, succs);
+    release(victim);
+  }
+
+  const_iterator cbegin() const
+  {
+    Guard guard(domain);
+    Node* node = pointer(head->next[0].load());
+    if(node != nullptr && isMarked(node->next[0].load()))
+      node = liveSuccessor(node);
+    return const_iterator(this, acquireFrom(node));
+  }
+
+  const_iterator cend() const
+  {
+    return const_iterator();
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+template <typename KeyType, typename ValueType>
+const int ConcurrentSkipListMap<KeyType, ValueType>::MAX_LEVEL;
+
+template <typename KeyType, typename ValueType>
+const std::uintptr_t ConcurrentSkipListMap<KeyType, ValueType>::MARK;
+
+// Forward iterator. It holds a reference on its node, so the item it points to stays readable
+// even if it gets removed meanwhile, without holding back reclamation of other nodes.
+// Stepping from a removed node continues with the first live key after it. Must not outlive its map.
+template <typename KeyType, typename ValueType>
+class ConcurrentSkipListMap<KeyType, ValueType>::ConstIterator
+{
+public:
+  using reference = typename ConcurrentSkipListMap::const_reference;
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = typename ConcurrentSkipListMap::value_type;
+  using pointer = const typename ConcurrentSkipListMap::value_type*;
+  using difference_type = std::ptrdiff_t;
+
+  explicit ConstIterator() : map(nullptr), currentNode(nullptr)
+  {}
+
+  ConstIterator(const ConstIterator& other) : map(other.map), currentNode(other.currentNode)
+  {
+    if(currentNode != nullptr)
+      currentNode->owners.fetch_add(1);
+  }
+
+  ConstIterator(ConstIterator&& other) noexcept : map(other.map), currentNode(other.currentNode)
+  {
+    other.currentNode = nullptr;
+  }
+
+  ConstIterator& operator=(ConstIterator other) noexcept
+  {
+    std::swap(map, other.map);
+    std::swap(currentNode, other.currentNode);
+    return *this;
+  }
+
+  ~ConstIterator()
+  {
+    if(currentNode != nullptr)
+      map->release(currentNode);
+  }
+
+  ConstIterator& operator++()
+  {
+    if(currentNode == nullptr)
+      throw std::out_of_range("cannot increment end");
+    Node* previous = currentNode;
+    {
+      Guard guard(map->domain);
+      // a link read unmarked under the guard leads to nodes that cannot be freed before it ends.
+      std::uintptr_t link = previous->next[0].load();
+      Node* next = isMarked(link) ? map->upperNode(previous->data.first) : ConcurrentSkipListMap::pointer(link);
+      if(next != nullptr && isMarked(next->next[0].load()))
+        next = liveSuccessor(next);
+      currentNode = acquireFrom(next);
+    }
+    map->release(previous);
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    auto tmp = *this;
+    operator++();
+    return tmp;
+  }
+
+  reference operator*() const
+  {
+    if(currentNode == nullptr)
+      throw std::out_of_range("Cannot dereference end");
+    return currentNode->data;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return currentNode == other.currentNode;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+
+private:
+  friend class ConcurrentSkipListMap;
+
+  const ConcurrentSkipListMap* map;
+  Node* currentNode;
+
+  // Takes over the reference already held on node.
+  ConstIterator(const ConcurrentSkipListMap* map_, Node* node) : map(map_), currentNode(node)
+  {}
+};
+}
+
+#endif /* AISDI_MAPS_CONCURRENTSKIPLISTMAP_H */
@@ -0,0 +1,312 @@
+#ifndef AISDI_MAPS_FROZENTREEMAP_H
+#define AISDI_MAPS_FROZENTREEMAP_H
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "TreeMap.h"
+
+namespace aisdi
+{
+
+// Read-only sorted map in Eytzinger layout: keys are stored in breadth first order of a complete
+// binary search tree, children of the node at (1-based) index k sit at 2k and 2k + 1. There are no
+// child pointers, the top levels share a few cache lines, and the search is a branch free loop
+// that prefetches the descendants four levels ahead. Values live in a parallel array, so keys are
+// packed tightly. Iteration walks the implicit tree in order using index arithmetic only.
+template <typename KeyType, typename ValueType, typename Compare = std::less<KeyType>>
+class FrozenTreeMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = std::pair<const key_type&, const mapped_type&>;
+  using const_reference = reference;
+  using key_compare = Compare;
+
+  class ConstIterator;
+  using iterator = ConstIterator;
+  using const_iterator = ConstIterator;
+
+private:
+  // Both indexed with k - 1 for the 1-based Eytzinger index k.
+  std::vector<key_type> keys;
+  std::vector<mapped_type> values;
+  Compare comp;
+
+  // In-order neighbours in the implicit tree of count nodes, 0 stands for past either end.
+  static size_type successor(size_type k, size_type count)
+  {
+    if(2 * k + 1 <= count)
+      return leftmost(2 * k + 1, count);
+    // climb while coming from a right child, then once more.
+    while((k & 1) != 0)
+      k >>= 1;
+    return k >> 1;
+  }
+
+  static size_type predecessor(size_type k, size_type count)
+  {
+    if(k == 0)
+      return rightmost(1, count);
+    if(2 * k <= count)
+      return rightmost(2 * k, count);
+    while(k != 0 && (k & 1) == 0)
+      k >>= 1;
+    return k >> 1;
+  }
+
+  static size_type leftmost(size_type k, size_type count)
+  {
+    if(k > count)
+      return 0;
+    while(2 * k <= count)
+      k = 2 * k;
+    return k;
+  }
+
+  static size_type rightmost(size_type k, size_type count)
+  {
+    if(k > count)
+      return 0;
+    while(2 * k + 1 <= count)
+      k = 2 * k + 1;
+    return k;
+  }
+
+  // Index of the smallest key not less than key, 0 if there is none.
+  size_type lowerIndex(const key_type& key) const
+  {
+    const size_type count = keys.size();
+    const key_type* base = keys.data();
+    size_type k = 1;
+    while(k <= count)
+    {
+#if defined(__GNUC__)
+      // descendants four levels down are 16 consecutive slots starting at 16k.
+      __builtin_prefetch(reinterpret_cast<const char*>(base) + (16 * k - 1) * sizeof(key_type));
+#endif
+      k = 2 * k + static_cast<size_type>(comp(base[k - 1], key));
+    }
+    // the path went right after the answer only, drop those steps and the final left one.
+    while((k & 1) != 0)
+      k >>= 1;
+    return k >> 1;
+  }
+
+  template <typename InputIt>
+  void build(InputIt first, InputIt last)
+  {
+    std::vector<std::pair<key_type, mapped_type>> sorted;
+    for(; first != last; ++first)
+    {
+      if(!sorted.empty() && !comp(sorted.back().first, (*first).first))
+        throw std::invalid_argument("keys are not sorted");
+      sorted.emplace_back((*first).first, (*first).second);
+    }
+
+    const size_type count = sorted.size();
+    std::vector<size_type> order(count);
+    size_type k = leftmost(1, count);
+    for(size_type i = 0; i < count; ++i, k = successor(k, count))
+      order[k - 1] = i;
+
+    keys.reserve(count);
+    values.reserve(count);
+    for(size_type position : order)
+    {
+      keys.push_back(sorted[position].first);
+      values.push_back(sorted[position].second);
+    }
+  }
+
+public:
+  explicit FrozenTreeMap(const Compare& comparator = Compare()) : comp(comparator)
+  {}
+
+  // Freezes the current contents of map, which stays independent of the result.
+  template <typename Allocator, typename Layout>
+  explicit FrozenTreeMap(const TreeMap<KeyType, ValueType, Compare, Allocator, Layout>& map) : comp(map.key_comp())
+  {
+    build(map.begin(), map.end());
+  }
+
+  template <typename InputIt>
+  static FrozenTreeMap fromSorted(InputIt first, InputIt last, const Compare& comparator = Compare())
+  {
+    FrozenTreeMap result(comparator);
+    result.build(first, last);
+    return result;
+  }
+
+  bool isEmpty() const
+  {
+    return keys.empty();
+  }
+
+  size_type getSize() const
+  {
+    return keys.size();
+  }
+
+  key_compare key_comp() const
+  {
+    return comp;
+  }
+
+  // First item with key not less than key.
+  const_iterator lower_bound(const key_type& key) const
+  {
+    return const_iterator(this, lowerIndex(key));
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    size_type k = lowerIndex(key);
+    if(k == 0 || comp(key, keys[k - 1]))
+      return cend();
+    return const_iterator(this, k);
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    if(isEmpty())
+      throw std::out_of_range("map is empty");
+    size_type k = lowerIndex(key);
+    if(k == 0 || comp(key, keys[k - 1]))
+      throw std::out_of_range("key does not exist");
+    return values[k - 1];
+  }
+
+  bool operator==(const FrozenTreeMap& other) const
+  {
+    return keys == other.keys && values == other.values;
+  }
+
+  bool operator!=(const FrozenTreeMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  const_iterator cbegin() const
+  {
+    return const_iterator(this, leftmost(1, keys.size()));
+  }
+
+  const_iterator cend() const
+  {
+    return const_iterator(this, 0);
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+// Keys and values are kept apart, so dereferencing yields a pair of references rather than a
+// reference to a stored pair, and operator-> goes through a small proxy holding that pair.
+template <typename KeyType, typename ValueType, typename Compare>
+class FrozenTreeMap<KeyType, ValueType, Compare>::ConstIterator
+{
+public:
+  using reference = typename FrozenTreeMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename FrozenTreeMap::value_type;
+  using difference_type = std::ptrdiff_t;
+
+  class pointer
+  {
+  public:
+    explicit pointer(reference item_) : item(item_)
+    {}
+
+    const reference* operator->() const
+    {
+      return &item;
+    }
+
+  private:
+    reference item;
+  };
+
+  explicit ConstIterator() : map(nullptr), index(0)
+  {}
+
+  ConstIterator(const FrozenTreeMap* map_, size_type index_) : map(map_), index(index_)
+  {}
+
+  ConstIterator& operator++()
+  {
+    if(index == 0)
+      throw std::out_of_range("cannot increment end");
+    index = FrozenTreeMap::successor(index, map->keys.size());
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    auto tmp = *this;
+    operator++();
+    return tmp;
+  }
+
+  ConstIterator& operator--()
+  {
+    if(map == nullptr || map->isEmpty())
+      throw std::out_of_range("Cannot decrement, empty map");
+    size_type previous = FrozenTreeMap::predecessor(index, map->keys.size());
+    if(previous == 0)
+      throw std::out_of_range("Cannot decrement begin");
+    index = previous;
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    auto tmp = *this;
+    operator--();
+    return tmp;
+  }
+
+  reference operator*() const
+  {
+    if(index == 0)
+      throw std::out_of_range("Cannot dereference end");
+    return reference(map->keys[index - 1], map->values[index - 1]);
+  }
+
+  pointer operator->() const
+  {
+    return pointer(this->operator*());
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return index == other.index;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+
+private:
+  const FrozenTreeMap* map;
+  size_type index;
+};
+
+}
+
+#endif /* AISDI_MAPS_FROZENTREEMAP_H */
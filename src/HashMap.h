@@ -2,16 +2,252 @@
 #define AISDI_MAPS_HASHMAP_H
 
 #include <cstddef>
+#include <cstdint>
 #include <initializer_list>
+#include <limits>
+#include <new>
 #include <stdexcept>
+#include <type_traits>
 #include <utility>
 #include <algorithm>
 #include <functional>
 #include <vector>
 
+#include "BloomFilter.h"
+
 namespace aisdi
 {
 
+namespace detail
+{
+
+// Finds HashMap nodes by key offset while integral keys are dense, no hashing involved. A presence
+// bitmap answers misses without loading any slot. While the map hashes instead, it only follows the
+// range of keys to tell when they become dense enough again. Other key types are never dense.
+template <typename Key, typename Node, bool = std::is_integral<Key>::value>
+class DirectIndex
+{
+public:
+  bool isActive() const
+  {
+    return false;
+  }
+
+  Node* find(const Key&) const
+  {
+    return nullptr;
+  }
+
+  bool insert(const Key&, Node*)
+  {
+    return false;
+  }
+
+  bool remove(const Key&)
+  {
+    return true;
+  }
+
+  void deactivate()
+  {}
+
+  void reset()
+  {}
+
+  bool observe(const Key&, std::size_t)
+  {
+    return false;
+  }
+
+  void activate(Node*, Node*)
+  {}
+};
+
+template <typename Key, typename Node>
+class DirectIndex<Key, Node, true>
+{
+public:
+  DirectIndex() : active(true), count(0), base(), low(), high()
+  {}
+
+  bool isActive() const
+  {
+    return active;
+  }
+
+  Node* find(const Key& key) const
+  {
+    std::size_t offset;
+    if(!locate(key, offset) || (present[offset / WORD] >> (offset % WORD) & 1) == 0)
+      return nullptr;
+    return slots[offset];
+  }
+
+  // Adds node under key, unless the keys would get too sparse for direct addressing.
+  bool insert(const Key& key, Node* node)
+  {
+    std::size_t offset = 0;
+    if(!locate(key, offset))
+    {
+      if(!cover(key))
+        return false;
+      locate(key, offset);
+    }
+    slots[offset] = node;
+    present[offset / WORD] |= std::uint64_t(1) << (offset % WORD);
+    widen(key, ++count);
+    return true;
+  }
+
+  // Returns false once the keys left are too sparse to keep addressing them directly.
+  bool remove(const Key& key)
+  {
+    std::size_t offset = 0;
+    locate(key, offset);
+    slots[offset] = nullptr;
+    present[offset / WORD] &= ~(std::uint64_t(1) << (offset % WORD));
+    count--;
+    return slots.size() <= MIN_SLOTS || count * SPARSE >= slots.size();
+  }
+
+  void deactivate()
+  {
+    active = false;
+    release();
+  }
+
+  // Starts over for an empty map.
+  void reset()
+  {
+    active = true;
+    release();
+  }
+
+  // Follows the key range while hashing, returns true once the keys fill it densely enough.
+  bool observe(const Key& key, std::size_t keys)
+  {
+    widen(key, keys);
+    return distance(low, high) < limit(keys);
+  }
+
+  // Indexes the nodes of the list between first and last, which hold distinct keys.
+  void activate(Node* first, Node* last)
+  {
+    Key lowest = first->value.first;
+    Key highest = first->value.first;
+    std::size_t nodes = 0;
+    for(Node* node = first; node != last; node = node->next, ++nodes)
+    {
+      lowest = std::min(lowest, node->value.first);
+      highest = std::max(highest, node->value.first);
+    }
+    std::vector<Node*> newSlots(static_cast<std::size_t>(distance(lowest, highest)) + 1, nullptr);
+    std::vector<std::uint64_t> newPresent((newSlots.size() + WORD - 1) / WORD, 0);
+    for(Node* node = first; node != last; node = node->next)
+    {
+      std::size_t offset = static_cast<std::size_t>(distance(lowest, node->value.first));
+      newSlots[offset] = node;
+      newPresent[offset / WORD] |= std::uint64_t(1) << (offset % WORD);
+    }
+    slots.swap(newSlots);
+    present.swap(newPresent);
+    base = low = lowest;
+    high = highest;
+    count = nodes;
+    active = true;
+  }
+
+private:
+  static const std::size_t WORD = 64;
+  // ranges this small are addressed directly however few keys they hold.
+  static const std::size_t MIN_SLOTS = 4096;
+  // a range may grow up to DENSE slots per key and shrink down to a key per SPARSE slots.
+  static const std::size_t DENSE = 8;
+  static const std::size_t SPARSE = 32;
+
+  bool active;
+  std::size_t count;
+  Key base;
+  std::vector<Node*> slots;
+  std::vector<std::uint64_t> present;
+  // bounds of the keys, never narrowed by removals, so they may be wider than the keys left.
+  Key low, high;
+
+  static std::uintmax_t distance(const Key& from, const Key& to)
+  {
+    return static_cast<std::uintmax_t>(to) - static_cast<std::uintmax_t>(from);
+  }
+
+  static std::uintmax_t limit(std::size_t keys)
+  {
+    return std::max(std::uintmax_t(MIN_SLOTS), std::uintmax_t(DENSE) * keys);
+  }
+
+  void widen(const Key& key, std::size_t keys)
+  {
+    if(keys == 1 || key < low)
+      low = key;
+    if(keys == 1 || high < key)
+      high = key;
+  }
+
+  bool locate(const Key& key, std::size_t& offset) const
+  {
+    if(slots.empty() || key < base || distance(base, key) >= slots.size())
+      return false;
+    offset = static_cast<std::size_t>(distance(base, key));
+    return true;
+  }
+
+  // Widens the slots to reach key, at least doubling them, or returns false when that is too sparse.
+  bool cover(const Key& key)
+  {
+    if(slots.empty())
+    {
+      slots.assign(1, nullptr);
+      present.assign(1, 0);
+      base = key;
+      return true;
+    }
+    if(distance(std::min(low, key), std::max(high, key)) >= limit(count + 1))
+      return false;
+    Key lowest = std::min(base, key);
+    Key highest = std::max(static_cast<Key>(static_cast<std::uintmax_t>(base) + (slots.size() - 1)), key);
+    std::uintmax_t span = distance(lowest, highest);
+    std::uintmax_t size = std::max<std::uintmax_t>(span + 1, 2 * slots.size());
+    // the room to spare goes to the side that grew, as far as the key type reaches.
+    std::uintmax_t spare = 0;
+    if(key < base)
+      spare = std::min(size - (span + 1), distance(std::numeric_limits<Key>::min(), lowest));
+    Key newBase = static_cast<Key>(static_cast<std::uintmax_t>(lowest) - spare);
+    std::uintmax_t room = distance(newBase, std::numeric_limits<Key>::max());
+    if(room < size - 1)
+      size = room + 1;
+    std::vector<Node*> newSlots(static_cast<std::size_t>(size), nullptr);
+    std::vector<std::uint64_t> newPresent((newSlots.size() + WORD - 1) / WORD, 0);
+    std::size_t shift = static_cast<std::size_t>(distance(newBase, base));
+    for(std::size_t offset = 0; offset < slots.size(); ++offset)
+      if(slots[offset] != nullptr)
+      {
+        newSlots[offset + shift] = slots[offset];
+        newPresent[(offset + shift) / WORD] |= std::uint64_t(1) << ((offset + shift) % WORD);
+      }
+    slots.swap(newSlots);
+    present.swap(newPresent);
+    base = newBase;
+    return true;
+  }
+
+  void release()
+  {
+    std::vector<Node*>().swap(slots);
+    std::vector<std::uint64_t>().swap(present);
+    count = 0;
+  }
+};
+
+}
+
 template <typename KeyType, typename ValueType>
 class HashMap
 {
@@ -46,8 +282,129 @@ private:
     size_type size = 0;
     static const size_type TABLE_SIZE = 16384;
     std::pair<Node*, Node*>* table;
+    // nodes of a bucket form a run [first, second) of the list, with first == second when empty.
+    detail::DirectIndex<key_type, Node> direct;
+    // rebuilt by insertions and removals once stale, lookups only read it.
+    BloomFilter<key_type> filter;
+
+    static size_type bucketOf(const key_type& key)
+    {
+        return std::hash<key_type>{}(key) % TABLE_SIZE;
+    }
 
+    // The presence bitmap of direct addressing already answers misses, the filter only saves hashing.
+    Node* findNode(const key_type& key) const
+    {
+        if(direct.isActive())
+            return direct.find(key);
+        if(filter.isEnabled() && !filter.mayContain(key))
+            return nullptr;
+        const auto& bucket = table[bucketOf(key)];
+        for(auto ptr = bucket.first; ptr != bucket.second; ptr = ptr->next)
+            if(ptr->value.first == key)
+                return ptr;
+        return nullptr;
+    }
+
+    void refilter()
+    {
+        BloomFilter<key_type> rebuilt;
+        rebuilt.reset(2 * size);
+        for(Node* node = tail->next; node != tail; node = node->next)
+            rebuilt.insert(node->value.first);
+        filter = std::move(rebuilt);
+    }
 
+    // Rebuilds the filter once removals or growth made it stale. The old one still holds every key,
+    // so it is kept when there is no memory for a new one.
+    void refreshFilter()
+    {
+        if(!filter.isEnabled() || !filter.needsRebuild(size))
+            return;
+        try
+        {
+            refilter();
+        }
+        catch(const std::bad_alloc&)
+        {
+        }
+    }
+
+    void append(Node* node)
+    {
+        node->prev = tail->prev;
+        node->next = tail;
+        tail->prev->next = node;
+        tail->prev = node;
+    }
+
+    // A node joins its bucket's run right after the run's first node, so no other run moves.
+    // The first node of a bucket starts a new run at the end of the list.
+    void linkHashed(Node* node)
+    {
+        auto& bucket = table[bucketOf(node->value.first)];
+        if(bucket.first == bucket.second)
+        {
+            Node* last = tail->prev;
+            append(node);
+            if(last != tail)
+                table[bucketOf(last->value.first)].second = node;
+            bucket.first = node;
+            bucket.second = tail;
+            return;
+        }
+        node->prev = bucket.first;
+        node->next = bucket.first->next;
+        bucket.first->next->prev = node;
+        bucket.first->next = node;
+    }
+
+    // Regroups all nodes into bucket runs, leaving direct addressing.
+    void hashAll()
+    {
+        std::fill(table, table + TABLE_SIZE, std::pair<Node*, Node*>(nullptr, nullptr));
+        Node* node = tail->next;
+        tail->next = tail->prev = tail;
+        while(node != tail)
+        {
+            Node* next = node->next;
+            linkHashed(node);
+            node = next;
+        }
+        direct.deactivate();
+    }
+
+    // Anything that throws does so before node is linked, so the caller may still delete it.
+    void link(Node* node)
+    {
+        if(filter.isEnabled())
+            filter.insert(node->value.first);
+        if(direct.isActive())
+        {
+            if(direct.insert(node->value.first, node))
+            {
+                append(node);
+                size++;
+                refreshFilter();
+                return;
+            }
+            hashAll();
+        }
+        linkHashed(node);
+        size++;
+        if(direct.observe(node->value.first, size))
+        {
+            // the node is in by now, so failing to switch over only leaves the map hashing.
+            try
+            {
+                direct.activate(tail->next, tail);
+            }
+            catch(...)
+            {
+            }
+        }
+        refreshFilter();
+    }
 
 public:
 
@@ -77,6 +434,7 @@ public:
 
       for(auto it = other.begin(); it!=other.end();it++)
           operator[]((*it).first)=(*it).second;
+      useBloomFilter(other.usesBloomFilter());
 
   }
 
@@ -94,12 +452,15 @@ public:
         }
       other.size = 0;
       other.tail = swappingTail;
+      std::swap(direct, other.direct);
+      std::swap(filter, other.filter);
 
 
   }
 
   HashMap& operator=(const HashMap& other)
   {
+      useBloomFilter(other.usesBloomFilter());
       if(*this == other)
           return *this;
 
@@ -135,6 +496,8 @@ public:
       }
       other.size = 0;
       other.tail = swappingPtr;
+      std::swap(direct, other.direct);
+      std::swap(filter, other.filter);
 
       return *this;
   }
@@ -146,38 +509,20 @@ public:
 
   mapped_type& operator[](const key_type& key)
   {
-      if(isEmpty())
+      Node* node = findNode(key);
+      if(node != nullptr)
+          return node->value.second;
+      node = new Node(key);
+      try
       {
-
-          auto newKey =(std::hash<key_type>{}(key)%TABLE_SIZE);
-          table[newKey].first=tail->next = tail->prev = new Node(key);
-          table[newKey].second = tail;
-          tail->prev->next=tail->next->prev=tail;
-
-          size++;
-          return tail->next->value.second;
+          link(node);
       }
-
-    if(find(key) == end())
-    {
-       auto  newNode = new Node(key);
-        tail->prev->next=newNode;
-        auto changeHashField = tail->prev->value.first;
-        newNode->prev=  tail->prev;
-        newNode->next = tail;
-        tail->prev = newNode;
-        table[(std::hash<key_type>{} (changeHashField)%TABLE_SIZE)].second=newNode;
-        auto newKey =(std::hash<key_type>{} (key)%TABLE_SIZE);
-        if(table[newKey].first==table[newKey].second)
-        {
-            table[newKey].first = newNode;
-            table[newKey].second = tail;
-
-        }
-        size++;
-        return newNode->value.second;
-    }else
-        return valueOf(key);
+      catch(...)
+      {
+          delete node;
+          throw;
+      }
+      return node->value.second;
   }
 
 
@@ -206,30 +551,13 @@ public:
   {
       if(isEmpty())
           return cend();
-      auto newKey =(std::hash<key_type>{} (key)%TABLE_SIZE);
-      if(table[newKey].first==table[newKey].second)
-        return cend();
-      for(auto ptr = table[newKey].first; ptr!=table[newKey].second;ptr = ptr->next)
-      {
-          if(ptr->value.first ==key)
-              return const_iterator(ptr,tail);
-      }
-      return cend();
+      Node* node = findNode(key);
+      return node == nullptr ? cend() : const_iterator(node, tail);
   }
 
   iterator find(const key_type& key)
   {
-      if(isEmpty())
-          return end();
-      auto newKey =(std::hash<key_type>{} (key)%TABLE_SIZE);
-      if(table[newKey].first==table[newKey].second)
-          return end();
-      for(auto ptr = table[newKey].first; ptr!=table[newKey].second;ptr = ptr->next)
-      {
-          if(ptr->value.first ==key)
-              return iterator(const_iterator(ptr,tail));
-      }
-      return end();
+      return iterator(static_cast<const HashMap&>(*this).find(key));
   }
 
   void remove(const key_type& key)
@@ -249,6 +577,22 @@ public:
           throw std::out_of_range("cannot remove, empty list");
       if(it==cend())
           throw std::out_of_range("cannot remove, no such element");
+      if(filter.isEnabled())
+          filter.noteRemoval();
+      if(direct.isActive())
+      {
+          Node* node = it.currentNode;
+          bool dense = direct.remove(node->value.first);
+          node->prev->next = node->next;
+          node->next->prev = node->prev;
+          delete node;
+          if(--size == 0)
+              direct.reset();
+          else if(!dense)
+              hashAll();
+          refreshFilter();
+          return;
+      }
       auto oldKey = std::hash<key_type>{}((*it).first) % TABLE_SIZE;
       auto deletingNode = it.currentNode;
 
@@ -284,7 +628,9 @@ public:
       }
 
       delete deletingNode;
-      size--;
+      if(--size == 0)
+          direct.reset();
+      refreshFilter();
 
 
   }
@@ -294,6 +640,20 @@ public:
     return size;
   }
 
+  // Keeps a Bloom filter of the keys, so that most lookups of missing keys skip the bucket's chain.
+  void useBloomFilter(bool enabled)
+  {
+      if(!enabled)
+          filter.release();
+      else if(!filter.isEnabled())
+          refilter();
+  }
+
+  bool usesBloomFilter() const
+  {
+      return filter.isEnabled();
+  }
+
   bool operator==(const HashMap& other) const
   {
       for(auto it = begin();it!= end();it++)
@@ -0,0 +1,311 @@
+#ifndef AISDI_MAPS_NODEPOOL_H
+#define AISDI_MAPS_NODEPOOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace aisdi
+{
+
+namespace detail
+{
+
+// Hands out fixed size slots carved from big contiguous slabs. Freed slots go to a free list,
+// the slabs themselves are only returned all at once by release().
+class SlabArena
+{
+public:
+  SlabArena(std::size_t size, std::size_t alignment)
+    : requestedSize(size), requestedAlignment(alignment),
+      slotAlignment(std::max(alignment, alignof(void*))),
+      slotSize(roundUp(std::max(size, sizeof(void*)), std::max(alignment, alignof(void*)))),
+      freeList(nullptr), cursor(nullptr), limit(nullptr), nextSlabSlots(FIRST_SLAB_SLOTS)
+  {}
+
+  SlabArena(const SlabArena&) = delete;
+  SlabArena& operator=(const SlabArena&) = delete;
+
+  ~SlabArena()
+  {
+    release();
+  }
+
+  bool serves(std::size_t size, std::size_t alignment) const
+  {
+    return size == requestedSize && alignment == requestedAlignment;
+  }
+
+  void* allocate()
+  {
+    if(freeList != nullptr)
+    {
+      void* slot = freeList;
+      freeList = *static_cast<void**>(slot);
+      return slot;
+    }
+    if(cursor == limit)
+      grow(nextSlabSlots);
+    void* slot = cursor;
+    cursor += slotSize;
+    return slot;
+  }
+
+  void deallocate(void* slot)
+  {
+    *static_cast<void**>(slot) = freeList;
+    freeList = slot;
+  }
+
+  // Makes sure the next count allocations are served from a single contiguous block.
+  void reserve(std::size_t count)
+  {
+    if(static_cast<std::size_t>(limit - cursor) < count * slotSize)
+      grow(count);
+  }
+
+  void release()
+  {
+    for(auto slab : slabs)
+      ::operator delete(slab);
+    slabs.clear();
+    freeList = nullptr;
+    cursor = limit = nullptr;
+    nextSlabSlots = FIRST_SLAB_SLOTS;
+  }
+
+private:
+  static const std::size_t FIRST_SLAB_SLOTS = 64;
+  static const std::size_t MAX_SLAB_SLOTS = 16384;
+
+  const std::size_t requestedSize;
+  const std::size_t requestedAlignment;
+  const std::size_t slotAlignment;
+  const std::size_t slotSize;
+  std::vector<void*> slabs;
+  void* freeList;
+  char* cursor;
+  char* limit;
+  std::size_t nextSlabSlots;
+
+  static std::size_t roundUp(std::size_t value, std::size_t alignment)
+  {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+
+  void grow(std::size_t count)
+  {
+    slabs.reserve(slabs.size() + 1);
+    char* slab = static_cast<char*>(::operator new(count * slotSize + slotAlignment));
+    slabs.push_back(slab);
+    auto address = reinterpret_cast<std::uintptr_t>(slab);
+    cursor = slab + (roundUp(address, slotAlignment) - address);
+    limit = cursor + count * slotSize;
+    nextSlabSlots = nextSlabSlots < MAX_SLAB_SLOTS / 2 ? nextSlabSlots * 2 : MAX_SLAB_SLOTS;
+  }
+};
+
+// The arenas shared by a pool with its copies and rebinds, one for every object size in use.
+class ArenaSet
+{
+public:
+  SlabArena& get(std::size_t size, std::size_t alignment)
+  {
+    for(auto& arena : arenas)
+      if(arena->serves(size, alignment))
+        return *arena;
+    arenas.emplace_back(new SlabArena(size, alignment));
+    return *arenas.back();
+  }
+
+  void release()
+  {
+    for(auto& arena : arenas)
+      arena->release();
+  }
+
+private:
+  std::vector<std::unique_ptr<SlabArena>> arenas;
+};
+
+}
+
+// Allocator serving single objects from slabs shared by all its copies and rebinds, every object
+// size gets slabs of its own. Bulk requests fall back to operator new. The arenas are created on
+// first use, so a default constructed pool costs nothing.
+template <typename T>
+class NodePool
+{
+public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  template <typename U>
+  struct rebind
+  {
+    using other = NodePool<U>;
+  };
+
+  NodePool() noexcept : arena(nullptr)
+  {}
+
+  NodePool(const NodePool& other) noexcept : arenas(other.arenas), arena(other.arena)
+  {}
+
+  NodePool(NodePool&& other) noexcept : arenas(std::move(other.arenas)), arena(other.arena)
+  {
+    other.arena = nullptr;
+  }
+
+  template <typename U>
+  NodePool(const NodePool<U>& other) noexcept : arenas(other.arenas), arena(nullptr)
+  {}
+
+  NodePool& operator=(const NodePool& other) noexcept
+  {
+    arenas = other.arenas;
+    arena = other.arena;
+    return *this;
+  }
+
+  NodePool& operator=(NodePool&& other) noexcept
+  {
+    arenas = std::move(other.arenas);
+    arena = other.arena;
+    other.arena = nullptr;
+    return *this;
+  }
+
+  // copied containers get their own slabs.
+  NodePool select_on_container_copy_construction() const
+  {
+    return NodePool();
+  }
+
+  T* allocate(std::size_t n)
+  {
+    if(n == 1)
+      return static_cast<T*>(ownArena().allocate());
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* pointer, std::size_t n) noexcept
+  {
+    // the arena of a slot always exists already, so looking it up cannot throw.
+    if(n == 1)
+      ownArena().deallocate(pointer);
+    else
+      ::operator delete(pointer);
+  }
+
+  void reserve(std::size_t n)
+  {
+    ownArena().reserve(n);
+  }
+
+  // Only the last holder of the slabs may drop them at once.
+  bool ownsSlabs() const noexcept
+  {
+    return !arenas || arenas.use_count() == 1;
+  }
+
+  void release() noexcept
+  {
+    if(arenas)
+      arenas->release();
+  }
+
+  template <typename U>
+  bool operator==(const NodePool<U>& other) const noexcept
+  {
+    return arenas == other.arenas;
+  }
+
+  template <typename U>
+  bool operator!=(const NodePool<U>& other) const noexcept
+  {
+    return !(*this == other);
+  }
+
+private:
+  template <typename U>
+  friend class NodePool;
+
+  std::shared_ptr<detail::ArenaSet> arenas;
+  // the arena of T, looked up once.
+  detail::SlabArena* arena;
+
+  detail::SlabArena& ownArena()
+  {
+    if(arena == nullptr)
+    {
+      if(!arenas)
+        arenas = std::make_shared<detail::ArenaSet>();
+      arena = &arenas->get(sizeof(T), alignof(T));
+    }
+    return *arena;
+  }
+};
+
+// Lets containers free all their nodes at once when the allocator supports it.
+template <typename Allocator>
+struct BulkRelease
+{
+  static bool available(const Allocator&)
+  {
+    return false;
+  }
+
+  static void release(Allocator&)
+  {}
+
+  static void reserve(Allocator&, std::size_t)
+  {}
+};
+
+template <typename T>
+struct BulkRelease<NodePool<T>>
+{
+  static bool available(const NodePool<T>& pool)
+  {
+    return pool.ownsSlabs();
+  }
+
+  static void release(NodePool<T>& pool)
+  {
+    pool.release();
+  }
+
+  static void reserve(NodePool<T>& pool, std::size_t n)
+  {
+    pool.reserve(n);
+  }
+};
+
+// Whether the allocator honours alignments stricter than operator new guarantees, which the
+// standard allocator does only since C++17.
+template <typename Allocator>
+struct OverAlignment
+{
+#ifdef __cpp_aligned_new
+  static const bool supported = true;
+#else
+  static const bool supported = false;
+#endif
+};
+
+template <typename T>
+struct OverAlignment<NodePool<T>>
+{
+  static const bool supported = true;
+};
+
+}
+
+#endif /* AISDI_MAPS_NODEPOOL_H */
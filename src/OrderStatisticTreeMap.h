@@ -0,0 +1,274 @@
+#ifndef AISDI_MAPS_ORDERSTATISTICTREEMAP_H
+#define AISDI_MAPS_ORDERSTATISTICTREEMAP_H
+
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#include "AugmentedTreeMap.h"
+
+namespace aisdi
+{
+
+// Ordered map kept balanced as a treap, where every node also stores the size of its subtree:
+// an AugmentedTreeMap counting its items. Thanks to these sizes rank(), select() and count() take
+// O(log n) instead of a full walk. The counts do not depend on the values, so unlike its base
+// it offers operator[] and writable iterators.
+// Being a treap it also supports split() and join() in expected O(log n).
+template <typename KeyType, typename ValueType>
+class OrderStatisticTreeMap : public AugmentedTreeMap<KeyType, ValueType, CountMonoid>
+{
+  using Base = AugmentedTreeMap<KeyType, ValueType, CountMonoid>;
+  using Node = typename Base::Node;
+
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+
+  using ConstIterator = typename Base::ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+private:
+  // Cuts tree into keys below key and the rest, expected O(log n) as it follows one search path.
+  void splitTree(Node* tree, const key_type& key, Node*& less, Node*& greater) const
+  {
+    if(tree == nullptr)
+    {
+      less = greater = nullptr;
+      return;
+    }
+    Node* lower;
+    Node* upper;
+    if(tree->data.first < key)
+    {
+      splitTree(tree->right, key, lower, upper);
+      tree->right = lower;
+      if(lower != nullptr)
+        lower->parent = tree;
+      less = tree;
+      greater = upper;
+    }
+    else
+    {
+      splitTree(tree->left, key, lower, upper);
+      tree->left = upper;
+      if(upper != nullptr)
+        upper->parent = tree;
+      less = lower;
+      greater = tree;
+    }
+    this->update(tree);
+  }
+
+  // Glues two trees where every key of less is below every key of greater, expected O(log n).
+  Node* joinTrees(Node* less, Node* greater) const
+  {
+    if(less == nullptr)
+      return greater;
+    if(greater == nullptr)
+      return less;
+    if(less->priority > greater->priority)
+    {
+      less->right = joinTrees(less->right, greater);
+      less->right->parent = less;
+      this->update(less);
+      return less;
+    }
+    greater->left = joinTrees(less, greater->left);
+    greater->left->parent = greater;
+    this->update(greater);
+    return greater;
+  }
+
+  void adopt(Node* tree)
+  {
+    Base::adopt(tree, this->aggregateOf(tree));
+  }
+
+public:
+  OrderStatisticTreeMap()
+  {}
+
+  OrderStatisticTreeMap(std::initializer_list<value_type> list) : Base(list)
+  {}
+
+  mapped_type& operator[](const key_type& key)
+  {
+    bool inserted;
+    return this->findOrInsert(key, mapped_type{}, inserted)->data.second;
+  }
+
+  using Base::valueOf;
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    return const_cast<mapped_type&>(Base::valueOf(key));
+  }
+
+  using Base::find;
+
+  iterator find(const key_type& key)
+  {
+    return iterator(Base::find(key));
+  }
+
+  // Number of keys strictly less than key.
+  size_type rank(const key_type& key) const
+  {
+    size_type result = 0;
+    const Node* current = this->head.left;
+    while(current != nullptr)
+    {
+      if(current->data.first < key)
+      {
+        result += this->aggregateOf(current->left) + 1;
+        current = current->right;
+      }
+      else
+        current = current->left;
+    }
+    return result;
+  }
+
+  // k-th smallest element, counting from zero.
+  const_iterator select(size_type k) const
+  {
+    if(k >= this->getSize())
+      throw std::out_of_range("cannot select, index out of range");
+    Node* current = this->head.left;
+    while(true)
+    {
+      size_type leftCount = this->aggregateOf(current->left);
+      if(k < leftCount)
+        current = current->left;
+      else if(k == leftCount)
+        return const_iterator(current);
+      else
+      {
+        k -= leftCount + 1;
+        current = current->right;
+      }
+    }
+  }
+
+  iterator select(size_type k)
+  {
+    return iterator(static_cast<const OrderStatisticTreeMap*>(this)->select(k));
+  }
+
+  // Number of keys in [first, last).
+  size_type count(const key_type& first, const key_type& last) const
+  {
+    if(!(first < last))
+      return 0;
+    return rank(last) - rank(first);
+  }
+
+  // Moves all items out of the map, keys below key into the first map and the rest into the second.
+  std::pair<OrderStatisticTreeMap, OrderStatisticTreeMap> split(const key_type& key)
+  {
+    Node* less;
+    Node* greater;
+    Node* tree = this->head.left;
+    this->head.left = nullptr;
+    this->size = 0;
+    splitTree(tree, key, less, greater);
+    std::pair<OrderStatisticTreeMap, OrderStatisticTreeMap> result;
+    result.first.adopt(less);
+    result.second.adopt(greater);
+    return result;
+  }
+
+  // Concatenates two maps, every key of less has to be below every key of greater.
+  static OrderStatisticTreeMap join(OrderStatisticTreeMap&& less, OrderStatisticTreeMap&& greater)
+  {
+    if(!less.isEmpty() && !greater.isEmpty()
+       && !(std::prev(less.cend())->first < greater.cbegin()->first))
+      throw std::invalid_argument("cannot join, key ranges overlap");
+    OrderStatisticTreeMap result;
+    result.adopt(result.joinTrees(less.head.left, greater.head.left));
+    less.head.left = nullptr;
+    less.size = 0;
+    greater.head.left = nullptr;
+    greater.size = 0;
+    return result;
+  }
+
+  using Base::begin;
+  using Base::end;
+
+  iterator begin()
+  {
+    return this->cbegin();
+  }
+
+  iterator end()
+  {
+    return this->cend();
+  }
+};
+
+template <typename KeyType, typename ValueType>
+class OrderStatisticTreeMap<KeyType, ValueType>::Iterator
+  : public OrderStatisticTreeMap<KeyType, ValueType>::ConstIterator
+{
+public:
+  using reference = typename OrderStatisticTreeMap::reference;
+  using pointer = typename OrderStatisticTreeMap::value_type*;
+
+  explicit Iterator()
+  {}
+
+  Iterator(const ConstIterator& other)
+    : ConstIterator(other)
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  reference operator*() const
+  {
+    // ugly cast, yet reduces code duplication.
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_ORDERSTATISTICTREEMAP_H */
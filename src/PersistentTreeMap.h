@@ -0,0 +1,369 @@
+#ifndef AISDI_MAPS_PERSISTENTTREEMAP_H
+#define AISDI_MAPS_PERSISTENTTREEMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Treap.h"
+
+namespace aisdi
+{
+
+// Immutable ordered map. Nodes are never changed once built: an update copies only the nodes on the
+// path to its key (a treap keeps that path O(log n) long) and shares the rest with older versions
+// through reference counts. Copying a map, or taking a snapshot(), is O(1), and a version is freed
+// when its last holder drops it. A snapshot can be read from other threads while the writer keeps
+// updating its own map, as long as the handover of the snapshot object itself is synchronized.
+// There is no operator[]: a mutable reference would leak writes into snapshots sharing the node.
+template <typename KeyType, typename ValueType>
+class PersistentTreeMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = const value_type&;
+  using const_reference = const value_type&;
+
+  class ConstIterator;
+  using iterator = ConstIterator;
+  using const_iterator = ConstIterator;
+
+private:
+  struct Node;
+  using NodePtr = std::shared_ptr<const Node>;
+
+  struct Node
+  {
+    value_type data;
+    NodePtr left, right;
+    std::uint32_t priority;
+
+    Node(const value_type& data_, NodePtr left_, NodePtr right_, std::uint32_t priority_)
+      : data(data_), left(std::move(left_)), right(std::move(right_)), priority(priority_)
+    {}
+  };
+
+  NodePtr root;
+  size_type size;
+  detail::TreapPriorities priorities;
+
+  static NodePtr makeNode(const value_type& data, NodePtr left, NodePtr right, std::uint32_t priority)
+  {
+    return std::make_shared<const Node>(data, std::move(left), std::move(right), priority);
+  }
+
+  // Returns the new version of tree, copying only the path to key plus the nodes rotated on the way up.
+  static NodePtr insert(const NodePtr& tree, const value_type& data, std::uint32_t priority)
+  {
+    if(!tree)
+      return makeNode(data, nullptr, nullptr, priority);
+    if(data.first < tree->data.first)
+    {
+      NodePtr left = insert(tree->left, data, priority);
+      if(left->priority > tree->priority)
+        return makeNode(left->data, left->left,
+                        makeNode(tree->data, left->right, tree->right, tree->priority), left->priority);
+      return makeNode(tree->data, std::move(left), tree->right, tree->priority);
+    }
+    if(tree->data.first < data.first)
+    {
+      NodePtr right = insert(tree->right, data, priority);
+      if(right->priority > tree->priority)
+        return makeNode(right->data, makeNode(tree->data, tree->left, right->left, tree->priority),
+                        right->right, right->priority);
+      return makeNode(tree->data, tree->left, std::move(right), tree->priority);
+    }
+    return makeNode(data, tree->left, tree->right, tree->priority);
+  }
+
+  static NodePtr join(const NodePtr& less, const NodePtr& greater)
+  {
+    if(!less)
+      return greater;
+    if(!greater)
+      return less;
+    if(less->priority > greater->priority)
+      return makeNode(less->data, less->left, join(less->right, greater), less->priority);
+    return makeNode(greater->data, join(less, greater->left), greater->right, greater->priority);
+  }
+
+  // key has to be present in tree.
+  static NodePtr erase(const NodePtr& tree, const key_type& key)
+  {
+    if(key < tree->data.first)
+      return makeNode(tree->data, erase(tree->left, key), tree->right, tree->priority);
+    if(tree->data.first < key)
+      return makeNode(tree->data, tree->left, erase(tree->right, key), tree->priority);
+    return join(tree->left, tree->right);
+  }
+
+  const Node* lookfor(const key_type& key) const
+  {
+    const Node* current = root.get();
+    while(current != nullptr)
+    {
+      if(key < current->data.first)
+        current = current->left.get();
+      else if(current->data.first < key)
+        current = current->right.get();
+      else
+        return current;
+    }
+    return nullptr;
+  }
+
+public:
+  PersistentTreeMap() : size(0)
+  {}
+
+  PersistentTreeMap(std::initializer_list<value_type> list) : PersistentTreeMap()
+  {
+    for(auto& element : list)
+      set(element.first, element.second);
+  }
+
+  PersistentTreeMap(const PersistentTreeMap& other) = default;
+  PersistentTreeMap(PersistentTreeMap&& other) noexcept
+    : root(std::move(other.root)), size(other.size), priorities(other.priorities)
+  {
+    other.size = 0;
+  }
+
+  PersistentTreeMap& operator=(const PersistentTreeMap& other) = default;
+  PersistentTreeMap& operator=(PersistentTreeMap&& other) noexcept
+  {
+    root = std::move(other.root);
+    size = other.size;
+    priorities = other.priorities;
+    other.size = 0;
+    return *this;
+  }
+
+  // O(1), the snapshot shares every node with this map and is unaffected by its later updates.
+  PersistentTreeMap snapshot() const
+  {
+    return *this;
+  }
+
+  bool isEmpty() const
+  {
+    return size == 0;
+  }
+
+  // Inserts key or replaces its value.
+  void set(const key_type& key, const mapped_type& value)
+  {
+    bool present = lookfor(key) != nullptr;
+    root = insert(root, value_type(key, value), priorities.next());
+    if(!present)
+      size++;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    if(isEmpty())
+      throw std::out_of_range("map is empty");
+    const Node* node = lookfor(key);
+    if(node == nullptr)
+      throw std::out_of_range("key does not exist");
+    return node->data.second;
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    if(lookfor(key) == nullptr)
+      return cend();
+    const_iterator it(root.get());
+    const Node* current = root.get();
+    while(true)
+    {
+      it.path.push_back(current);
+      if(key < current->data.first)
+        current = current->left.get();
+      else if(current->data.first < key)
+        current = current->right.get();
+      else
+        return it;
+    }
+  }
+
+  void remove(const key_type& key)
+  {
+    if(isEmpty())
+      throw std::out_of_range("cannot remove, empty list");
+    if(lookfor(key) == nullptr)
+      throw std::out_of_range("cannot remove, no such element");
+    root = erase(root, key);
+    size--;
+  }
+
+  void remove(const const_iterator& it)
+  {
+    if(it.path.empty())
+      throw std::out_of_range("cannot remove, no such element");
+    remove(it->first);
+  }
+
+  size_type getSize() const
+  {
+    return size;
+  }
+
+  bool operator==(const PersistentTreeMap& other) const
+  {
+    if(size != other.size)
+      return false;
+    if(root == other.root)
+      return true;
+    for(auto thisIt = begin(), otherIt = other.begin(); thisIt != end(); ++thisIt, ++otherIt)
+      if(!(otherIt->first == thisIt->first && otherIt->second == thisIt->second))
+        return false;
+    return true;
+  }
+
+  bool operator!=(const PersistentTreeMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  const_iterator cbegin() const
+  {
+    const_iterator it(root.get());
+    for(const Node* current = root.get(); current != nullptr; current = current->left.get())
+      it.path.push_back(current);
+    return it;
+  }
+
+  const_iterator cend() const
+  {
+    return const_iterator(root.get());
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+// Nodes carry no parent links since they are shared between versions,
+// so the iterator keeps the path from the root instead. It is valid as long as its version lives.
+template <typename KeyType, typename ValueType>
+class PersistentTreeMap<KeyType, ValueType>::ConstIterator
+{
+public:
+  using reference = typename PersistentTreeMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename PersistentTreeMap::value_type;
+  using pointer = const typename PersistentTreeMap::value_type*;
+  using difference_type = std::ptrdiff_t;
+
+  const Node* root;
+  std::vector<const Node*> path;
+
+  explicit ConstIterator() : root(nullptr)
+  {}
+
+  explicit ConstIterator(const Node* root_) : root(root_)
+  {}
+
+  ConstIterator& operator++()
+  {
+    if(path.empty())
+      throw std::out_of_range("cannot increment end");
+    if(path.back()->right)
+    {
+      for(const Node* current = path.back()->right.get(); current != nullptr; current = current->left.get())
+        path.push_back(current);
+      return *this;
+    }
+    const Node* child = path.back();
+    path.pop_back();
+    while(!path.empty() && path.back()->right.get() == child)
+    {
+      child = path.back();
+      path.pop_back();
+    }
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    auto tmp = *this;
+    operator++();
+    return tmp;
+  }
+
+  ConstIterator& operator--()
+  {
+    if(path.empty())
+    {
+      if(root == nullptr)
+        throw std::out_of_range("Cannot decrement, empty map");
+      for(const Node* current = root; current != nullptr; current = current->right.get())
+        path.push_back(current);
+      return *this;
+    }
+    if(path.back()->left)
+    {
+      for(const Node* current = path.back()->left.get(); current != nullptr; current = current->right.get())
+        path.push_back(current);
+      return *this;
+    }
+    // the predecessor is the nearest ancestor entered through its right link, look before popping.
+    std::size_t depth = path.size() - 1;
+    while(depth > 0 && path[depth - 1]->left.get() == path[depth])
+      depth--;
+    if(depth == 0)
+      throw std::out_of_range("Cannot decrement begin");
+    path.resize(depth);
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    auto tmp = *this;
+    operator--();
+    return tmp;
+  }
+
+  reference operator*() const
+  {
+    if(path.empty())
+      throw std::out_of_range("Cannot dereference end");
+    return path.back()->data;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    if(path.empty() || other.path.empty())
+      return path.empty() && other.path.empty() && root == other.root;
+    return path.back() == other.path.back();
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_PERSISTENTTREEMAP_H */
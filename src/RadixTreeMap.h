@@ -0,0 +1,1102 @@
+#ifndef AISDI_MAPS_RADIXTREEMAP_H
+#define AISDI_MAPS_RADIXTREEMAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace aisdi
+{
+
+// Maps a key to bytes whose lexicographic order is the order of the keys. Specialize it to use
+// other key types; Bytes needs data() and size() and has to stay valid while the key does.
+template <typename Key, typename Enable = void>
+struct RadixKey;
+
+// Integers are written big-endian, signed ones with the sign bit flipped so negatives come first.
+template <typename Key>
+struct RadixKey<Key, typename std::enable_if<std::is_integral<Key>::value>::type>
+{
+  class Bytes
+  {
+  public:
+    explicit Bytes(Key key)
+    {
+      using Unsigned = typename std::make_unsigned<Key>::type;
+      Unsigned value = static_cast<Unsigned>(key);
+      if(std::is_signed<Key>::value)
+        value ^= static_cast<Unsigned>(Unsigned(1) << (8 * sizeof(Key) - 1));
+      for(std::size_t i = sizeof(Key); i-- > 0;)
+      {
+        bytes[i] = static_cast<unsigned char>(value & 0xff);
+        value = static_cast<Unsigned>(value >> 8);
+      }
+    }
+
+    const unsigned char* data() const
+    {
+      return bytes;
+    }
+
+    std::size_t size() const
+    {
+      return sizeof(Key);
+    }
+
+  private:
+    unsigned char bytes[sizeof(Key)];
+  };
+};
+
+// Strings compare like their bytes taken as unsigned chars, so they are used as they are.
+template <>
+struct RadixKey<std::string>
+{
+  class Bytes
+  {
+  public:
+    explicit Bytes(const std::string& key)
+      : bytes(reinterpret_cast<const unsigned char*>(key.data())), length(key.size())
+    {}
+
+    const unsigned char* data() const
+    {
+      return bytes;
+    }
+
+    std::size_t size() const
+    {
+      return length;
+    }
+
+  private:
+    const unsigned char* bytes;
+    std::size_t length;
+  };
+};
+
+// Adaptive radix tree (Leis, Kemper, Neumann). Inner nodes branch on one key byte and come in four
+// sizes, 4, 16, 48 and 256 children, growing and shrinking with their fan-out, so sparse levels
+// stay small and dense ones are a direct array lookup. Every inner node keeps the whole run of
+// bytes its single-child ancestors would have had (pessimistic path compression), and a key is
+// stored in a leaf as soon as its path is unique. Lookups cost O(key length) byte steps and one
+// full key comparison at the leaf, independent of the number of items.
+// A key that is a proper prefix of others, possible with strings, sits in its node's terminal slot.
+template <typename KeyType, typename ValueType>
+class RadixTreeMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+private:
+  using Bytes = typename RadixKey<key_type>::Bytes;
+
+  struct Leaf
+  {
+    value_type data;
+
+    explicit Leaf(const key_type& key) : data(key, mapped_type{})
+    {}
+    explicit Leaf(const value_type& data_) : data(data_)
+    {}
+  };
+
+  enum class Kind : unsigned char { NODE4, NODE16, NODE48, NODE256 };
+
+  // Child links are leaves tagged with the lowest bit or untagged inner nodes, 0 means none.
+  using Ref = std::uintptr_t;
+  static const Ref LEAF = 1;
+
+  struct Inner
+  {
+    Kind kind;
+    unsigned short count;
+    std::string prefix;
+    Leaf* terminal;
+
+    explicit Inner(Kind kind_) : kind(kind_), count(0), terminal(nullptr)
+    {}
+  };
+
+  // Node4 and Node16 keep their key bytes sorted.
+  struct Node4 : Inner
+  {
+    unsigned char keys[4];
+    Ref children[4];
+
+    Node4() : Inner(Kind::NODE4)
+    {}
+  };
+
+  struct Node16 : Inner
+  {
+    unsigned char keys[16];
+    Ref children[16];
+
+    Node16() : Inner(Kind::NODE16)
+    {}
+  };
+
+  // index maps a byte to its slot in children plus one, 0 means no child.
+  struct Node48 : Inner
+  {
+    unsigned char index[256];
+    Ref children[48];
+
+    Node48() : Inner(Kind::NODE48)
+    {
+      std::fill(index, index + 256, 0);
+      std::fill(children, children + 48, 0);
+    }
+  };
+
+  struct Node256 : Inner
+  {
+    Ref children[256];
+
+    Node256() : Inner(Kind::NODE256)
+    {
+      std::fill(children, children + 256, 0);
+    }
+  };
+
+  // Position inside an inner node while walking the tree: byte of the child taken, or BEFORE when
+  // standing on the terminal, which sorts ahead of all children.
+  struct Frame
+  {
+    Inner* node;
+    int position;
+  };
+
+  static const int BEFORE = -1;
+  static const int AFTER = 256;
+
+  Ref root;
+  size_type size;
+
+  static bool isLeaf(Ref ref)
+  {
+    return (ref & LEAF) != 0;
+  }
+
+  static Leaf* asLeaf(Ref ref)
+  {
+    return reinterpret_cast<Leaf*>(ref & ~LEAF);
+  }
+
+  static Inner* asInner(Ref ref)
+  {
+    return reinterpret_cast<Inner*>(ref);
+  }
+
+  static Ref refTo(Leaf* leaf)
+  {
+    return reinterpret_cast<Ref>(leaf) | LEAF;
+  }
+
+  static Ref refTo(Inner* node)
+  {
+    return reinterpret_cast<Ref>(node);
+  }
+
+  static size_type capacity(const Inner* node)
+  {
+    switch(node->kind)
+    {
+    case Kind::NODE4:
+      return 4;
+    case Kind::NODE16:
+      return 16;
+    case Kind::NODE48:
+      return 48;
+    default:
+      return 256;
+    }
+  }
+
+  static Ref* findChild(Inner* node, unsigned char byte)
+  {
+    switch(node->kind)
+    {
+    case Kind::NODE4:
+    {
+      Node4* n = static_cast<Node4*>(node);
+      for(unsigned i = 0; i < n->count; ++i)
+        if(n->keys[i] == byte)
+          return &n->children[i];
+      return nullptr;
+    }
+    case Kind::NODE16:
+    {
+      Node16* n = static_cast<Node16*>(node);
+#ifdef __SSE2__
+      __m128i matches = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(byte)),
+                                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(n->keys)));
+      unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(matches)) & ((1u << n->count) - 1);
+      if(mask == 0)
+        return nullptr;
+      return &n->children[__builtin_ctz(mask)];
+#else
+      for(unsigned i = 0; i < n->count; ++i)
+        if(n->keys[i] == byte)
+          return &n->children[i];
+      return nullptr;
+#endif
+    }
+    case Kind::NODE48:
+    {
+      Node48* n = static_cast<Node48*>(node);
+      return n->index[byte] == 0 ? nullptr : &n->children[n->index[byte] - 1];
+    }
+    default:
+    {
+      Node256* n = static_cast<Node256*>(node);
+      return n->children[byte] == 0 ? nullptr : &n->children[byte];
+    }
+    }
+  }
+
+  // First child with byte greater than after, as (byte, child); byte is AFTER when there is none.
+  static std::pair<int, Ref> nextChild(const Inner* node, int after)
+  {
+    switch(node->kind)
+    {
+    case Kind::NODE4:
+    case Kind::NODE16:
+    {
+      const unsigned char* keys = keysOf(node);
+      const Ref* children = childrenOf(node);
+      for(unsigned i = 0; i < node->count; ++i)
+        if(keys[i] > after)
+          return std::make_pair(static_cast<int>(keys[i]), children[i]);
+      break;
+    }
+    case Kind::NODE48:
+    {
+      const Node48* n = static_cast<const Node48*>(node);
+      for(int byte = after + 1; byte < 256; ++byte)
+        if(n->index[byte] != 0)
+          return std::make_pair(byte, n->children[n->index[byte] - 1]);
+      break;
+    }
+    default:
+    {
+      const Node256* n = static_cast<const Node256*>(node);
+      for(int byte = after + 1; byte < 256; ++byte)
+        if(n->children[byte] != 0)
+          return std::make_pair(byte, n->children[byte]);
+    }
+    }
+    return std::make_pair(AFTER, Ref(0));
+  }
+
+  // Last child with byte less than before, as (byte, child); byte is BEFORE when there is none.
+  static std::pair<int, Ref> previousChild(const Inner* node, int before)
+  {
+    switch(node->kind)
+    {
+    case Kind::NODE4:
+    case Kind::NODE16:
+    {
+      const unsigned char* keys = keysOf(node);
+      const Ref* children = childrenOf(node);
+      for(unsigned i = node->count; i-- > 0;)
+        if(keys[i] < before)
+          return std::make_pair(static_cast<int>(keys[i]), children[i]);
+      break;
+    }
+    case Kind::NODE48:
+    {
+      const Node48* n = static_cast<const Node48*>(node);
+      for(int byte = before - 1; byte >= 0; --byte)
+        if(n->index[byte] != 0)
+          return std::make_pair(byte, n->children[n->index[byte] - 1]);
+      break;
+    }
+    default:
+    {
+      const Node256* n = static_cast<const Node256*>(node);
+      for(int byte = before - 1; byte >= 0; --byte)
+        if(n->children[byte] != 0)
+          return std::make_pair(byte, n->children[byte]);
+    }
+    }
+    return std::make_pair(BEFORE, Ref(0));
+  }
+
+  static const unsigned char* keysOf(const Inner* node)
+  {
+    return node->kind == Kind::NODE4 ? static_cast<const Node4*>(node)->keys
+                                     : static_cast<const Node16*>(node)->keys;
+  }
+
+  static const Ref* childrenOf(const Inner* node)
+  {
+    return node->kind == Kind::NODE4 ? static_cast<const Node4*>(node)->children
+                                     : static_cast<const Node16*>(node)->children;
+  }
+
+  // Adds a child to a node that is not full.
+  static void insertChild(Inner* node, unsigned char byte, Ref child)
+  {
+    switch(node->kind)
+    {
+    case Kind::NODE4:
+    case Kind::NODE16:
+    {
+      unsigned char* keys = const_cast<unsigned char*>(keysOf(node));
+      Ref* children = const_cast<Ref*>(childrenOf(node));
+      unsigned position = node->count;
+      while(position > 0 && keys[position - 1] > byte)
+      {
+        keys[position] = keys[position - 1];
+        children[position] = children[position - 1];
+        position--;
+      }
+      keys[position] = byte;
+      children[position] = child;
+      break;
+    }
+    case Kind::NODE48:
+    {
+      Node48* n = static_cast<Node48*>(node);
+      unsigned slot = 0;
+      while(n->children[slot] != 0)
+        slot++;
+      n->children[slot] = child;
+      n->index[byte] = static_cast<unsigned char>(slot + 1);
+      break;
+    }
+    default:
+      static_cast<Node256*>(node)->children[byte] = child;
+    }
+    node->count++;
+  }
+
+  static void eraseChild(Inner* node, unsigned char byte)
+  {
+    switch(node->kind)
+    {
+    case Kind::NODE4:
+    case Kind::NODE16:
+    {
+      unsigned char* keys = const_cast<unsigned char*>(keysOf(node));
+      Ref* children = const_cast<Ref*>(childrenOf(node));
+      unsigned position = 0;
+      while(keys[position] != byte)
+        position++;
+      for(; position + 1 < node->count; ++position)
+      {
+        keys[position] = keys[position + 1];
+        children[position] = children[position + 1];
+      }
+      break;
+    }
+    case Kind::NODE48:
+    {
+      Node48* n = static_cast<Node48*>(node);
+      n->children[n->index[byte] - 1] = 0;
+      n->index[byte] = 0;
+      break;
+    }
+    default:
+      static_cast<Node256*>(node)->children[byte] = 0;
+    }
+    node->count--;
+  }
+
+  static Inner* createInner(Kind kind)
+  {
+    switch(kind)
+    {
+    case Kind::NODE4:
+      return new Node4;
+    case Kind::NODE16:
+      return new Node16;
+    case Kind::NODE48:
+      return new Node48;
+    default:
+      return new Node256;
+    }
+  }
+
+  // Frees the node alone, children and terminal are left to the caller.
+  static void deleteInner(Inner* node)
+  {
+    switch(node->kind)
+    {
+    case Kind::NODE4:
+      delete static_cast<Node4*>(node);
+      break;
+    case Kind::NODE16:
+      delete static_cast<Node16*>(node);
+      break;
+    case Kind::NODE48:
+      delete static_cast<Node48*>(node);
+      break;
+    default:
+      delete static_cast<Node256*>(node);
+    }
+  }
+
+  // Moves everything from node into a new node of another size, which replaces it in ref.
+  static void resize(Ref& ref, Kind kind)
+  {
+    Inner* node = asInner(ref);
+    Inner* resized = createInner(kind);
+    resized->prefix.swap(node->prefix);
+    resized->terminal = node->terminal;
+    for(auto child = nextChild(node, BEFORE); child.first != AFTER; child = nextChild(node, child.first))
+      insertChild(resized, static_cast<unsigned char>(child.first), child.second);
+    deleteInner(node);
+    ref = refTo(resized);
+  }
+
+  static void addChild(Ref& ref, unsigned char byte, Ref child)
+  {
+    Inner* node = asInner(ref);
+    if(node->count == capacity(node))
+    {
+      resize(ref, node->kind == Kind::NODE4 ? Kind::NODE16 : node->kind == Kind::NODE16 ? Kind::NODE48 : Kind::NODE256);
+      node = asInner(ref);
+    }
+    insertChild(node, byte, child);
+  }
+
+  // After a removal: shrinks a node that got sparse, or replaces it by its only remaining entry.
+  static void shrink(Ref& ref)
+  {
+    Inner* node = asInner(ref);
+    switch(node->kind)
+    {
+    case Kind::NODE4:
+      if(node->count == 0)
+      {
+        ref = node->terminal == nullptr ? 0 : refTo(node->terminal);
+        deleteInner(node);
+      }
+      else if(node->count == 1 && node->terminal == nullptr)
+      {
+        Node4* n = static_cast<Node4*>(node);
+        Ref child = n->children[0];
+        if(!isLeaf(child))
+        {
+          Inner* below = asInner(child);
+          below->prefix = n->prefix + static_cast<char>(n->keys[0]) + below->prefix;
+        }
+        ref = child;
+        deleteInner(node);
+      }
+      break;
+    case Kind::NODE16:
+      if(node->count <= 3)
+        resize(ref, Kind::NODE4);
+      break;
+    case Kind::NODE48:
+      if(node->count <= 12)
+        resize(ref, Kind::NODE16);
+      break;
+    default:
+      if(node->count <= 37)
+        resize(ref, Kind::NODE48);
+    }
+  }
+
+  static void destroy(Ref ref)
+  {
+    if(ref == 0)
+      return;
+    if(isLeaf(ref))
+    {
+      delete asLeaf(ref);
+      return;
+    }
+    Inner* node = asInner(ref);
+    for(auto child = nextChild(node, BEFORE); child.first != AFTER; child = nextChild(node, child.first))
+      destroy(child.second);
+    delete node->terminal;
+    deleteInner(node);
+  }
+
+  static Ref clone(Ref ref)
+  {
+    if(isLeaf(ref))
+      return refTo(new Leaf(asLeaf(ref)->data));
+    const Inner* node = asInner(ref);
+    Inner* copy = createInner(node->kind);
+    try
+    {
+      copy->prefix = node->prefix;
+      if(node->terminal != nullptr)
+        copy->terminal = new Leaf(node->terminal->data);
+      for(auto child = nextChild(node, BEFORE); child.first != AFTER; child = nextChild(node, child.first))
+      {
+        Ref childCopy = clone(child.second);
+        insertChild(copy, static_cast<unsigned char>(child.first), childCopy);
+      }
+    }
+    catch(...)
+    {
+      destroy(refTo(copy));
+      throw;
+    }
+    return refTo(copy);
+  }
+
+  // Number of bytes of prefix matching the key from depth on.
+  static size_type matchPrefix(const Inner* node, const Bytes& bytes, size_type depth)
+  {
+    size_type matched = 0;
+    const size_type limit = std::min(node->prefix.size(), bytes.size() - depth);
+    while(matched < limit && static_cast<unsigned char>(node->prefix[matched]) == bytes.data()[depth + matched])
+      matched++;
+    return matched;
+  }
+
+  // Hangs leaf under a fresh node whose key bytes end at depth.
+  static void place(Node4* node, Leaf* leaf, const Bytes& bytes, size_type depth)
+  {
+    if(depth == bytes.size())
+      node->terminal = leaf;
+    else
+      insertChild(node, bytes.data()[depth], refTo(leaf));
+  }
+
+  Leaf* insert(Ref& ref, const key_type& key, const Bytes& bytes, size_type depth)
+  {
+    if(ref == 0)
+    {
+      Leaf* leaf = new Leaf(key);
+      ref = refTo(leaf);
+      size++;
+      return leaf;
+    }
+    if(isLeaf(ref))
+    {
+      Leaf* existing = asLeaf(ref);
+      if(existing->data.first == key)
+        return existing;
+      // both keys share the bytes up to common, a new node branches them apart there.
+      Bytes other(existing->data.first);
+      size_type common = depth;
+      while(common < bytes.size() && common < other.size() && bytes.data()[common] == other.data()[common])
+        common++;
+      std::unique_ptr<Leaf> leaf(new Leaf(key));
+      // the node owns no children, so dropping it if the prefix cannot be copied frees nothing else.
+      std::unique_ptr<Node4> node(new Node4);
+      node->prefix.assign(reinterpret_cast<const char*>(bytes.data()) + depth, common - depth);
+      place(node.get(), existing, other, common);
+      place(node.get(), leaf.get(), bytes, common);
+      ref = refTo(node.release());
+      size++;
+      return leaf.release();
+    }
+
+    Inner* node = asInner(ref);
+    size_type matched = matchPrefix(node, bytes, depth);
+    if(matched < node->prefix.size())
+    {
+      // the key leaves the compressed path halfway, split it there.
+      std::unique_ptr<Leaf> leaf(new Leaf(key));
+      std::unique_ptr<Node4> parent(new Node4);
+      parent->prefix = node->prefix.substr(0, matched);
+      unsigned char branch = static_cast<unsigned char>(node->prefix[matched]);
+      node->prefix.erase(0, matched + 1);
+      insertChild(parent.get(), branch, ref);
+      place(parent.get(), leaf.get(), bytes, depth + matched);
+      ref = refTo(parent.release());
+      size++;
+      return leaf.release();
+    }
+    depth += matched;
+    if(depth == bytes.size())
+    {
+      if(node->terminal == nullptr)
+      {
+        node->terminal = new Leaf(key);
+        size++;
+      }
+      return node->terminal;
+    }
+    Ref* child = findChild(node, bytes.data()[depth]);
+    if(child != nullptr)
+      return insert(*child, key, bytes, depth + 1);
+    std::unique_ptr<Leaf> leaf(new Leaf(key));
+    addChild(ref, bytes.data()[depth], refTo(leaf.get()));
+    size++;
+    return leaf.release();
+  }
+
+  bool erase(Ref& ref, const key_type& key, const Bytes& bytes, size_type depth)
+  {
+    if(ref == 0)
+      return false;
+    if(isLeaf(ref))
+    {
+      if(!(asLeaf(ref)->data.first == key))
+        return false;
+      delete asLeaf(ref);
+      ref = 0;
+      return true;
+    }
+    Inner* node = asInner(ref);
+    size_type matched = matchPrefix(node, bytes, depth);
+    if(matched < node->prefix.size())
+      return false;
+    depth += matched;
+    if(depth == bytes.size())
+    {
+      if(node->terminal == nullptr)
+        return false;
+      delete node->terminal;
+      node->terminal = nullptr;
+      shrink(ref);
+      return true;
+    }
+    unsigned char byte = bytes.data()[depth];
+    Ref* child = findChild(node, byte);
+    if(child == nullptr || !erase(*child, key, bytes, depth + 1))
+      return false;
+    if(*child == 0)
+    {
+      eraseChild(node, byte);
+      shrink(ref);
+    }
+    return true;
+  }
+
+  // Finds the leaf holding key, recording the way down in path when given.
+  Leaf* lookfor(const key_type& key, std::vector<Frame>* path) const
+  {
+    Bytes bytes(key);
+    Ref ref = root;
+    size_type depth = 0;
+    while(ref != 0)
+    {
+      if(isLeaf(ref))
+        return asLeaf(ref)->data.first == key ? asLeaf(ref) : nullptr;
+      Inner* node = asInner(ref);
+      if(matchPrefix(node, bytes, depth) < node->prefix.size())
+        return nullptr;
+      depth += node->prefix.size();
+      if(depth == bytes.size())
+      {
+        if(path != nullptr)
+          path->push_back(Frame{node, BEFORE});
+        return node->terminal;
+      }
+      unsigned char byte = bytes.data()[depth];
+      Ref* child = findChild(node, byte);
+      if(child == nullptr)
+        return nullptr;
+      if(path != nullptr)
+        path->push_back(Frame{node, byte});
+      ref = *child;
+      depth++;
+    }
+    return nullptr;
+  }
+
+public:
+  RadixTreeMap() : root(0), size(0)
+  {}
+
+  RadixTreeMap(std::initializer_list<value_type> list) : RadixTreeMap()
+  {
+    for(auto& element : list)
+      operator[](element.first) = element.second;
+  }
+
+  RadixTreeMap(const RadixTreeMap& other) : RadixTreeMap()
+  {
+    if(other.root != 0)
+      root = clone(other.root);
+    size = other.size;
+  }
+
+  RadixTreeMap(RadixTreeMap&& other) noexcept : root(other.root), size(other.size)
+  {
+    other.root = 0;
+    other.size = 0;
+  }
+
+  ~RadixTreeMap()
+  {
+    destroy(root);
+  }
+
+  RadixTreeMap& operator=(const RadixTreeMap& other)
+  {
+    if(this == &other)
+      return *this;
+    RadixTreeMap copy(other);
+    return *this = std::move(copy);
+  }
+
+  RadixTreeMap& operator=(RadixTreeMap&& other) noexcept
+  {
+    if(this == &other)
+      return *this;
+    destroy(root);
+    root = other.root;
+    size = other.size;
+    other.root = 0;
+    other.size = 0;
+    return *this;
+  }
+
+  bool isEmpty() const
+  {
+    return size == 0;
+  }
+
+  void clear()
+  {
+    destroy(root);
+    root = 0;
+    size = 0;
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    Bytes bytes(key);
+    return insert(root, key, bytes, 0)->data.second;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    if(isEmpty())
+      throw std::out_of_range("map is empty");
+    Leaf* leaf = lookfor(key, nullptr);
+    if(leaf == nullptr)
+      throw std::out_of_range("key does not exist");
+    return leaf->data.second;
+  }
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    return const_cast<mapped_type&>(static_cast<const RadixTreeMap*>(this)->valueOf(key));
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    const_iterator it(this);
+    it.leaf = lookfor(key, &it.path);
+    if(it.leaf == nullptr)
+      return cend();
+    return it;
+  }
+
+  iterator find(const key_type& key)
+  {
+    return static_cast<const RadixTreeMap*>(this)->find(key);
+  }
+
+  void remove(const key_type& key)
+  {
+    if(isEmpty())
+      throw std::out_of_range("cannot remove, empty list");
+    Bytes bytes(key);
+    if(!erase(root, key, bytes, 0))
+      throw std::out_of_range("cannot remove, no such element");
+    size--;
+  }
+
+  void remove(const const_iterator& it)
+  {
+    if(it.leaf == nullptr)
+      throw std::out_of_range("cannot remove, no such element");
+    remove(it->first);
+  }
+
+  size_type getSize() const
+  {
+    return size;
+  }
+
+  bool operator==(const RadixTreeMap& other) const
+  {
+    if(size != other.size)
+      return false;
+    for(auto thisIt = begin(), otherIt = other.begin(); thisIt != end(); ++thisIt, ++otherIt)
+      if(!(otherIt->first == thisIt->first && otherIt->second == thisIt->second))
+        return false;
+    return true;
+  }
+
+  bool operator!=(const RadixTreeMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  iterator begin()
+  {
+    return cbegin();
+  }
+
+  iterator end()
+  {
+    return cend();
+  }
+
+  const_iterator cbegin() const
+  {
+    const_iterator it(this);
+    if(root != 0)
+      it.descendFirst(root);
+    return it;
+  }
+
+  const_iterator cend() const
+  {
+    return const_iterator(this);
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+template <typename KeyType, typename ValueType>
+const typename RadixTreeMap<KeyType, ValueType>::Ref RadixTreeMap<KeyType, ValueType>::LEAF;
+
+template <typename KeyType, typename ValueType>
+const int RadixTreeMap<KeyType, ValueType>::BEFORE;
+
+template <typename KeyType, typename ValueType>
+const int RadixTreeMap<KeyType, ValueType>::AFTER;
+
+// Nodes have no parent links, the iterator keeps the path from the root instead. In every inner node
+// the terminal comes first, then the children by byte. Any change to the map invalidates it.
+template <typename KeyType, typename ValueType>
+class RadixTreeMap<KeyType, ValueType>::ConstIterator
+{
+public:
+  using reference = typename RadixTreeMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename RadixTreeMap::value_type;
+  using pointer = const typename RadixTreeMap::value_type*;
+  using difference_type = std::ptrdiff_t;
+
+  explicit ConstIterator(const RadixTreeMap* map_ = nullptr) : map(map_), leaf(nullptr)
+  {}
+
+  ConstIterator& operator++()
+  {
+    if(leaf == nullptr)
+      throw std::out_of_range("cannot increment end");
+    leaf = nullptr;
+    while(!path.empty())
+    {
+      Frame& top = path.back();
+      auto child = RadixTreeMap::nextChild(top.node, top.position);
+      if(child.first != RadixTreeMap::AFTER)
+      {
+        top.position = child.first;
+        descendFirst(child.second);
+        return *this;
+      }
+      path.pop_back();
+    }
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    auto tmp = *this;
+    operator++();
+    return tmp;
+  }
+
+  ConstIterator& operator--()
+  {
+    if(map == nullptr || map->isEmpty())
+      throw std::out_of_range("Cannot decrement, empty map");
+    if(leaf == nullptr)
+    {
+      descendLast(map->root);
+      return *this;
+    }
+    ConstIterator previous = *this;
+    while(!path.empty())
+    {
+      Frame& top = path.back();
+      if(top.position != RadixTreeMap::BEFORE)
+      {
+        auto child = RadixTreeMap::previousChild(top.node, top.position);
+        if(child.first != RadixTreeMap::BEFORE)
+        {
+          top.position = child.first;
+          descendLast(child.second);
+          return *this;
+        }
+        if(top.node->terminal != nullptr)
+        {
+          top.position = RadixTreeMap::BEFORE;
+          leaf = top.node->terminal;
+          return *this;
+        }
+      }
+      path.pop_back();
+    }
+    *this = previous;
+    throw std::out_of_range("Cannot decrement begin");
+  }
+
+  ConstIterator operator--(int)
+  {
+    auto tmp = *this;
+    operator--();
+    return tmp;
+  }
+
+  reference operator*() const
+  {
+    if(leaf == nullptr)
+      throw std::out_of_range("Cannot dereference end");
+    return leaf->data;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return leaf == other.leaf;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+
+private:
+  friend class RadixTreeMap;
+
+  const RadixTreeMap* map;
+  std::vector<Frame> path;
+  Leaf* leaf;
+
+  void descendFirst(Ref ref)
+  {
+    while(!RadixTreeMap::isLeaf(ref))
+    {
+      Inner* node = RadixTreeMap::asInner(ref);
+      if(node->terminal != nullptr)
+      {
+        path.push_back(Frame{node, RadixTreeMap::BEFORE});
+        leaf = node->terminal;
+        return;
+      }
+      auto child = RadixTreeMap::nextChild(node, RadixTreeMap::BEFORE);
+      path.push_back(Frame{node, child.first});
+      ref = child.second;
+    }
+    leaf = RadixTreeMap::asLeaf(ref);
+  }
+
+  void descendLast(Ref ref)
+  {
+    while(!RadixTreeMap::isLeaf(ref))
+    {
+      Inner* node = RadixTreeMap::asInner(ref);
+      auto child = RadixTreeMap::previousChild(node, RadixTreeMap::AFTER);
+      if(child.first == RadixTreeMap::BEFORE)
+      {
+        path.push_back(Frame{node, RadixTreeMap::BEFORE});
+        leaf = node->terminal;
+        return;
+      }
+      path.push_back(Frame{node, child.first});
+      ref = child.second;
+    }
+    leaf = RadixTreeMap::asLeaf(ref);
+  }
+};
+
+template <typename KeyType, typename ValueType>
+class RadixTreeMap<KeyType, ValueType>::Iterator : public RadixTreeMap<KeyType, ValueType>::ConstIterator
+{
+public:
+  using reference = typename RadixTreeMap::reference;
+  using pointer = typename RadixTreeMap::value_type*;
+
+  explicit Iterator()
+  {}
+
+  Iterator(const ConstIterator& other)
+    : ConstIterator(other)
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  reference operator*() const
+  {
+    // ugly cast, yet reduces code duplication.
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_RADIXTREEMAP_H */
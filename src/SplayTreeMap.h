@@ -0,0 +1,572 @@
+#ifndef AISDI_MAPS_SPLAYTREEMAP_H
+#define AISDI_MAPS_SPLAYTREEMAP_H
+
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "NodePool.h"
+
+namespace aisdi
+{
+
+// Self-adjusting TreeMap variant. Every lookup splays the found key to the root with a top-down
+// splay, so hot keys stay a few comparisons away and no recursion or parent pointers are needed.
+// Lookups restructure the tree even on a const map. Iterators keep a pointer to their map,
+// so they are invalidated when the map is moved.
+template <typename KeyType, typename ValueType,
+          typename Allocator = NodePool<std::pair<const KeyType, ValueType>>>
+class SplayTreeMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using allocator_type = Allocator;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+private:
+  struct Node
+  {
+    value_type data;
+    Node *left, *right;
+
+    Node(const key_type& key) : data(std::make_pair(key, mapped_type{})), left(nullptr), right(nullptr) {}
+    Node(const value_type& data_) : data(data_), left(nullptr), right(nullptr) {}
+  };
+
+  using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAllocator>;
+
+  mutable Node* root;
+  size_type size;
+  NodeAllocator allocator;
+
+  template <typename... Args>
+  Node* createNode(Args&&... args)
+  {
+    Node* node = NodeTraits::allocate(allocator, 1);
+    try
+    {
+      NodeTraits::construct(allocator, node, std::forward<Args>(args)...);
+    }
+    catch(...)
+    {
+      NodeTraits::deallocate(allocator, node, 1);
+      throw;
+    }
+    return node;
+  }
+
+  void destroyNode(Node* node)
+  {
+    NodeTraits::destroy(allocator, node);
+    NodeTraits::deallocate(allocator, node, 1);
+  }
+
+  // Top-down splay: brings key, or the last node on its search path, to the top of the tree.
+  static Node* splay(Node* tree, const key_type& key)
+  {
+    if(tree == nullptr)
+      return tree;
+    Node* leftTree = nullptr;
+    Node* rightTree = nullptr;
+    Node** leftHook = &leftTree;
+    Node** rightHook = &rightTree;
+    while(true)
+    {
+      if(key < tree->data.first)
+      {
+        if(tree->left == nullptr)
+          break;
+        if(key < tree->left->data.first)
+        {
+          Node* rotated = tree->left;
+          tree->left = rotated->right;
+          rotated->right = tree;
+          tree = rotated;
+          if(tree->left == nullptr)
+            break;
+        }
+        *rightHook = tree;
+        rightHook = &tree->left;
+        tree = tree->left;
+      }
+      else if(tree->data.first < key)
+      {
+        if(tree->right == nullptr)
+          break;
+        if(tree->right->data.first < key)
+        {
+          Node* rotated = tree->right;
+          tree->right = rotated->left;
+          rotated->left = tree;
+          tree = rotated;
+          if(tree->right == nullptr)
+            break;
+        }
+        *leftHook = tree;
+        leftHook = &tree->right;
+        tree = tree->right;
+      }
+      else
+        break;
+    }
+    *leftHook = tree->left;
+    *rightHook = tree->right;
+    tree->left = leftTree;
+    tree->right = rightTree;
+    return tree;
+  }
+
+  bool splayTo(const key_type& key) const
+  {
+    root = splay(root, key);
+    return root != nullptr && !(key < root->data.first) && !(root->data.first < key);
+  }
+
+  Node* minimum() const
+  {
+    if(root == nullptr)
+      return nullptr;
+    Node* node = root;
+    while(node->left != nullptr)
+      node = node->left;
+    splayTo(node->data.first);
+    return root;
+  }
+
+  Node* maximum() const
+  {
+    if(root == nullptr)
+      return nullptr;
+    Node* node = root;
+    while(node->right != nullptr)
+      node = node->right;
+    splayTo(node->data.first);
+    return root;
+  }
+
+  // splaying keys in order costs O(1) amortized per step, so full scans stay linear.
+  Node* successor(const Node* node) const
+  {
+    splayTo(node->data.first);
+    Node* next = root->right;
+    if(next == nullptr)
+      return nullptr;
+    while(next->left != nullptr)
+      next = next->left;
+    return next;
+  }
+
+  Node* predecessor(const Node* node) const
+  {
+    splayTo(node->data.first);
+    Node* previous = root->left;
+    if(previous == nullptr)
+      return nullptr;
+    while(previous->right != nullptr)
+      previous = previous->right;
+    return previous;
+  }
+
+  static Node* linkBalanced(Node* const* nodes, size_type count)
+  {
+    if(count == 0)
+      return nullptr;
+    size_type middle = count / 2;
+    Node* node = nodes[middle];
+    node->left = linkBalanced(nodes, middle);
+    node->right = linkBalanced(nodes + middle + 1, count - middle - 1);
+    return node;
+  }
+
+  void steal(SplayTreeMap& other) noexcept
+  {
+    root = other.root;
+    size = other.size;
+    other.root = nullptr;
+    other.size = 0;
+  }
+
+public:
+  SplayTreeMap() : root(nullptr), size(0)
+  {}
+
+  explicit SplayTreeMap(const Allocator& alloc) : root(nullptr), size(0), allocator(alloc)
+  {}
+
+  SplayTreeMap(std::initializer_list<value_type> list) : SplayTreeMap()
+  {
+    for(auto& element : list)
+      operator[](element.first) = element.second;
+  }
+
+  SplayTreeMap(const SplayTreeMap& other)
+    : root(nullptr), size(0),
+      allocator(NodeTraits::select_on_container_copy_construction(other.allocator))
+  {
+    std::vector<Node*> nodes;
+    nodes.reserve(other.size);
+    try
+    {
+      for(auto& element : other)
+        nodes.push_back(createNode(element));
+    }
+    catch(...)
+    {
+      for(auto node : nodes)
+        destroyNode(node);
+      throw;
+    }
+    root = linkBalanced(nodes.data(), nodes.size());
+    size = nodes.size();
+  }
+
+  SplayTreeMap(SplayTreeMap&& other) noexcept : allocator(std::move(other.allocator))
+  {
+    steal(other);
+  }
+
+  ~SplayTreeMap()
+  {
+    clear();
+  }
+
+  SplayTreeMap& operator=(const SplayTreeMap& other)
+  {
+    if(this == &other)
+      return *this;
+    SplayTreeMap copy(other);
+    return *this = std::move(copy);
+  }
+
+  SplayTreeMap& operator=(SplayTreeMap&& other) noexcept
+  {
+    if(this == &other)
+      return *this;
+    clear();
+    allocator = std::move(other.allocator);
+    steal(other);
+    return *this;
+  }
+
+  void clear()
+  {
+    bool bulk = BulkRelease<NodeAllocator>::available(allocator);
+    if(!bulk || !std::is_trivially_destructible<value_type>::value)
+    {
+      // rotating left children up flattens the tree into a list, no recursion needed.
+      Node* node = root;
+      while(node != nullptr)
+      {
+        if(node->left != nullptr)
+        {
+          Node* rotated = node->left;
+          node->left = rotated->right;
+          rotated->right = node;
+          node = rotated;
+          continue;
+        }
+        Node* next = node->right;
+        if(bulk)
+          NodeTraits::destroy(allocator, node);
+        else
+          destroyNode(node);
+        node = next;
+      }
+    }
+    if(bulk)
+      BulkRelease<NodeAllocator>::release(allocator);
+    root = nullptr;
+    size = 0;
+  }
+
+  bool isEmpty() const
+  {
+    return size == 0;
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    if(splayTo(key))
+      return root->data.second;
+    Node* newNode = createNode(key);
+    if(root != nullptr)
+    {
+      if(key < root->data.first)
+      {
+        newNode->left = root->left;
+        newNode->right = root;
+        root->left = nullptr;
+      }
+      else
+      {
+        newNode->right = root->right;
+        newNode->left = root;
+        root->right = nullptr;
+      }
+    }
+    root = newNode;
+    size++;
+    return newNode->data.second;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    if(isEmpty())
+      throw std::out_of_range("map is empty");
+    if(!splayTo(key))
+      throw std::out_of_range("key does not exist");
+    return root->data.second;
+  }
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    if(isEmpty())
+      throw std::out_of_range("map is empty");
+    if(!splayTo(key))
+      throw std::out_of_range("key does not exist");
+    return root->data.second;
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    return const_iterator(splayTo(key) ? root : nullptr, this);
+  }
+
+  iterator find(const key_type& key)
+  {
+    return iterator(const_iterator(splayTo(key) ? root : nullptr, this));
+  }
+
+  void remove(const key_type& key)
+  {
+    if(isEmpty())
+      throw std::out_of_range("cannot remove, empty list");
+    if(!splayTo(key))
+      throw std::out_of_range("cannot remove, no such element");
+    Node* removingNode = root;
+    if(removingNode->left == nullptr)
+      root = removingNode->right;
+    else
+    {
+      // key is greater than everything on the left, so splaying it there lifts the maximum.
+      root = splay(removingNode->left, key);
+      root->right = removingNode->right;
+    }
+    destroyNode(removingNode);
+    size--;
+  }
+
+  void remove(const const_iterator& it)
+  {
+    if(it.currentNode == nullptr)
+      throw std::out_of_range("cannot remove, no such element");
+    remove(it.currentNode->data.first);
+  }
+
+  size_type getSize() const
+  {
+    return size;
+  }
+
+  bool operator==(const SplayTreeMap& other) const
+  {
+    if(size != other.size)
+      return false;
+    for(auto thisIt = begin(), otherIt = other.begin(); thisIt != end(); ++thisIt, ++otherIt)
+      if(!(otherIt->first == thisIt->first && otherIt->second == thisIt->second))
+        return false;
+    return true;
+  }
+
+  bool operator!=(const SplayTreeMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  iterator begin()
+  {
+    return cbegin();
+  }
+
+  iterator end()
+  {
+    return cend();
+  }
+
+  const_iterator cbegin() const
+  {
+    return const_iterator(minimum(), this);
+  }
+
+  const_iterator cend() const
+  {
+    return const_iterator(nullptr, this);
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Allocator>
+class SplayTreeMap<KeyType, ValueType, Allocator>::ConstIterator
+{
+public:
+  using reference = typename SplayTreeMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename SplayTreeMap::value_type;
+  using pointer = const typename SplayTreeMap::value_type*;
+  using difference_type = std::ptrdiff_t;
+
+  Node* currentNode;
+  const SplayTreeMap* map;
+
+  explicit ConstIterator() : currentNode(nullptr), map(nullptr)
+  {}
+
+  ConstIterator(Node* pointer, const SplayTreeMap* map_) : currentNode(pointer), map(map_)
+  {}
+
+  ConstIterator(const ConstIterator& other) : currentNode(other.currentNode), map(other.map)
+  {}
+
+  ConstIterator& operator=(const ConstIterator& other) = default;
+
+  ConstIterator& operator++()
+  {
+    if(currentNode == nullptr)
+      throw std::out_of_range("cannot increment end");
+    currentNode = map->successor(currentNode);
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    auto tmp = *this;
+    operator++();
+    return tmp;
+  }
+
+  ConstIterator& operator--()
+  {
+    if(currentNode == nullptr)
+    {
+      if(map->isEmpty())
+        throw std::out_of_range("Cannot decrement, empty map");
+      currentNode = map->maximum();
+      return *this;
+    }
+    Node* previous = map->predecessor(currentNode);
+    if(previous == nullptr)
+      throw std::out_of_range("Cannot decrement begin");
+    currentNode = previous;
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    auto tmp = *this;
+    operator--();
+    return tmp;
+  }
+
+  reference operator*() const
+  {
+    if(currentNode == nullptr)
+      throw std::out_of_range("Cannot dereference end");
+    return currentNode->data;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return this->currentNode == other.currentNode;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Allocator>
+class SplayTreeMap<KeyType, ValueType, Allocator>::Iterator
+  : public SplayTreeMap<KeyType, ValueType, Allocator>::ConstIterator
+{
+public:
+  using reference = typename SplayTreeMap::reference;
+  using pointer = typename SplayTreeMap::value_type*;
+
+  explicit Iterator()
+  {}
+
+  Iterator(const ConstIterator& other)
+    : ConstIterator(other)
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  reference operator*() const
+  {
+    // ugly cast, yet reduces code duplication.
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_SPLAYTREEMAP_H */
@@ -0,0 +1,330 @@
+#ifndef AISDI_MAPS_THREADPOOL_H
+#define AISDI_MAPS_THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace aisdi
+{
+
+class TaskGroup;
+
+// Fixed set of worker threads with a task deque each. A worker takes its own newest task first,
+// which keeps recursively split work cache warm, and when it runs dry it steals the oldest task
+// of another worker, normally the biggest piece left. Tasks submitted from outside the pool are
+// dealt to the workers in turn. They and plain submit() tasks queue at the front, so the back of
+// a deque only holds group tasks its worker pushed itself. Tasks given to submit() must not throw,
+// see TaskGroup.
+class ThreadPool
+{
+public:
+  explicit ThreadPool(std::size_t threadCount = defaultThreadCount())
+    : pending(0), next(0), stopping(false)
+  {
+    if(threadCount == 0)
+      threadCount = 1;
+    for(std::size_t i = 0; i < threadCount; ++i)
+      workers.emplace_back(new Worker);
+    try
+    {
+      for(std::size_t i = 0; i < threadCount; ++i)
+        threads.emplace_back(&ThreadPool::work, this, i);
+    }
+    catch(...)
+    {
+      stop();
+      throw;
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Runs the tasks still queued, then joins the workers.
+  ~ThreadPool()
+  {
+    stop();
+  }
+
+  static std::size_t defaultThreadCount()
+  {
+    std::size_t count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+  }
+
+  // Pool with a worker per hardware thread, created on first use.
+  static ThreadPool& shared()
+  {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  std::size_t getThreadCount() const
+  {
+    return workers.size();
+  }
+
+  void submit(std::function<void()> task)
+  {
+    submit(std::move(task), nullptr);
+  }
+
+private:
+  friend class TaskGroup;
+
+  struct Task
+  {
+    std::function<void()> run;
+    // group waiting for the task, null for plain submits.
+    const TaskGroup* group;
+  };
+
+  struct Worker
+  {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  struct Current
+  {
+    ThreadPool* pool;
+    std::size_t index;
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+  std::atomic<std::size_t> pending;
+  std::atomic<std::size_t> next;
+  std::mutex sleepMutex;
+  std::condition_variable wakeUp;
+  bool stopping;
+
+  // Pool and worker index of the calling thread, the pool is null outside of workers.
+  static Current& current()
+  {
+    static thread_local Current value = { nullptr, 0 };
+    return value;
+  }
+
+  bool isWorker() const
+  {
+    return current().pool == this;
+  }
+
+  void submit(std::function<void()> task, const TaskGroup* group)
+  {
+    const bool inside = isWorker();
+    const bool nested = inside && group != nullptr;
+    std::size_t index = inside ? current().index : next++ % workers.size();
+    pending++;
+    {
+      std::lock_guard<std::mutex> lock(workers[index]->mutex);
+      Task queued = { std::move(task), group };
+      if(nested)
+        workers[index]->tasks.push_back(std::move(queued));
+      else
+        workers[index]->tasks.push_front(std::move(queued));
+    }
+    // taking the lock orders this with a worker checking pending before it sleeps.
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wakeUp.notify_one();
+  }
+
+  // Runs one queued task of group on the calling thread, if there is any. Lets waiting threads help
+  // out without picking up unrelated work, which could nest waits deeper than the split itself.
+  bool runPending(const TaskGroup* group)
+  {
+    Task task;
+    if(!take(isWorker() ? current().index : workers.size(), group, task))
+      return false;
+    task.run();
+    return true;
+  }
+
+  // Takes the newest or the oldest task of worker, the nearest one of group to that end if given.
+  static bool pop(Worker& worker, bool newest, const TaskGroup* group, Task& task)
+  {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    auto& tasks = worker.tasks;
+    for(std::size_t i = 0; i < tasks.size(); ++i)
+    {
+      auto found = newest ? tasks.end() - 1 - i : tasks.begin() + i;
+      if(group != nullptr && found->group != group)
+        continue;
+      task = std::move(*found);
+      tasks.erase(found);
+      return true;
+    }
+    return false;
+  }
+
+  // Takes the newest task of worker index, or else the oldest of another one. Only tasks of group
+  // qualify unless it is null. An index past the workers stands for a thread outside the pool.
+  bool take(std::size_t index, const TaskGroup* group, Task& task)
+  {
+    const bool own = index < workers.size();
+    if(own && pop(*workers[index], true, group, task))
+    {
+      pending--;
+      return true;
+    }
+    for(std::size_t i = own ? 1 : 0; i < workers.size(); ++i)
+    {
+      if(pop(*workers[(index + i) % workers.size()], false, group, task))
+      {
+        pending--;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void work(std::size_t index)
+  {
+    current().pool = this;
+    current().index = index;
+    while(true)
+    {
+      Task task;
+      if(take(index, nullptr, task))
+      {
+        task.run();
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(sleepMutex);
+      wakeUp.wait(lock, [this] { return stopping || pending != 0; });
+      if(stopping && pending == 0)
+        return;
+    }
+  }
+
+  void stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      stopping = true;
+    }
+    wakeUp.notify_all();
+    for(auto& thread : threads)
+      thread.join();
+  }
+};
+
+// Fork-join on a pool: run() submits a task, wait() returns once all of them finished. The waiting
+// thread runs queued tasks of the group meanwhile, so groups may nest inside pool tasks without
+// starving it. The first exception thrown by a task is rethrown from wait().
+class TaskGroup
+{
+public:
+  explicit TaskGroup(ThreadPool& pool_) : pool(pool_), unfinished(0)
+  {}
+
+  TaskGroup(const TaskGroup&) = delete;
+  TaskGroup& operator=(const TaskGroup&) = delete;
+
+  ~TaskGroup()
+  {
+    finish();
+  }
+
+  template <typename Function>
+  void run(Function fn)
+  {
+    unfinished++;
+    try
+    {
+      pool.submit([this, fn]() {
+        try
+        {
+          fn();
+        }
+        catch(...)
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if(!error)
+            error = std::current_exception();
+        }
+        unfinished--;
+      }, this);
+    }
+    catch(...)
+    {
+      unfinished--;
+      throw;
+    }
+  }
+
+  void wait()
+  {
+    finish();
+    std::exception_ptr thrown;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::swap(thrown, error);
+    }
+    if(thrown)
+      std::rethrow_exception(thrown);
+  }
+
+private:
+  ThreadPool& pool;
+  std::atomic<std::size_t> unfinished;
+  std::mutex mutex;
+  std::exception_ptr error;
+
+  void finish()
+  {
+    while(unfinished != 0)
+      if(!pool.runPending(this))
+        std::this_thread::yield();
+  }
+};
+
+// Sorts [first, last) on pool: a piece per worker is sorted on its own, then neighbouring pieces
+// are merged pairwise, every round of merges running in parallel. Small ranges are sorted in place.
+template <typename RandomIt, typename Less>
+void parallelSort(RandomIt first, RandomIt last, Less less, ThreadPool& pool)
+{
+  const std::size_t count = static_cast<std::size_t>(last - first);
+  const std::size_t pieces = std::min(pool.getThreadCount(), count / 4096);
+  if(pieces < 2)
+  {
+    std::sort(first, last, less);
+    return;
+  }
+  std::vector<std::size_t> bounds(pieces + 1);
+  for(std::size_t i = 0; i <= pieces; ++i)
+    bounds[i] = count * i / pieces;
+
+  TaskGroup group(pool);
+  for(std::size_t i = 0; i < pieces; ++i)
+    group.run([first, &bounds, &less, i]() { std::sort(first + bounds[i], first + bounds[i + 1], less); });
+  group.wait();
+  for(std::size_t width = 1; width < pieces; width *= 2)
+  {
+    for(std::size_t i = 0; i + width < pieces; i += 2 * width)
+    {
+      std::size_t end = bounds[std::min(i + 2 * width, pieces)];
+      group.run([first, &bounds, &less, i, width, end]() {
+        std::inplace_merge(first + bounds[i], first + bounds[i + width], first + end, less);
+      });
+    }
+    group.wait();
+  }
+}
+
+}
+
+#endif /* AISDI_MAPS_THREADPOOL_H */
@@ -0,0 +1,620 @@
+#ifndef AISDI_MAPS_THREADEDTREEMAP_H
+#define AISDI_MAPS_THREADEDTREEMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "NodePool.h"
+
+namespace aisdi
+{
+
+// TreeMap variant without parent pointers. A missing child link is replaced by a thread
+// to the in-order predecessor (left) or successor (right), flagged in the lowest pointer bit,
+// so iterators step through the tree without climbing and without a stack.
+// Nodes are one pointer smaller than TreeMap nodes, the parent link is gone.
+template <typename KeyType, typename ValueType,
+          typename Allocator = NodePool<std::pair<const KeyType, ValueType>>>
+class ThreadedTreeMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using allocator_type = Allocator;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+private:
+  struct Node
+  {
+    value_type data;
+    std::uintptr_t left, right;
+
+    Node() : data(), left(0), right(0) {}
+    Node(const key_type& key) : data(std::make_pair(key, mapped_type{})), left(0), right(0) {}
+    Node(const value_type& data_) : data(data_), left(0), right(0) {}
+  };
+
+  static const std::uintptr_t THREAD = 1;
+
+  static std::uintptr_t child(Node* node)
+  {
+    return reinterpret_cast<std::uintptr_t>(node);
+  }
+
+  static std::uintptr_t thread(Node* node)
+  {
+    return reinterpret_cast<std::uintptr_t>(node) | THREAD;
+  }
+
+  static bool isThread(std::uintptr_t link)
+  {
+    return (link & THREAD) != 0;
+  }
+
+  static Node* target(std::uintptr_t link)
+  {
+    return reinterpret_cast<Node*>(link & ~THREAD);
+  }
+
+  static Node* leftmost(Node* node)
+  {
+    while(!isThread(node->left))
+      node = target(node->left);
+    return node;
+  }
+
+  static Node* rightmost(Node* node)
+  {
+    while(!isThread(node->right))
+      node = target(node->right);
+    return node;
+  }
+
+  using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAllocator>;
+
+  // head is the end() sentinel, its left link is the root (or a thread to itself when empty).
+  Node head;
+  size_type size;
+  NodeAllocator allocator;
+
+  Node* sentinel() const
+  {
+    return const_cast<Node*>(&head);
+  }
+
+  void init()
+  {
+    head.left = thread(&head);
+    head.right = thread(&head);
+    size = 0;
+  }
+
+  template <typename... Args>
+  Node* createNode(Args&&... args)
+  {
+    Node* node = NodeTraits::allocate(allocator, 1);
+    try
+    {
+      NodeTraits::construct(allocator, node, std::forward<Args>(args)...);
+    }
+    catch(...)
+    {
+      NodeTraits::deallocate(allocator, node, 1);
+      throw;
+    }
+    return node;
+  }
+
+  void destroyNode(Node* node)
+  {
+    NodeTraits::destroy(allocator, node);
+    NodeTraits::deallocate(allocator, node, 1);
+  }
+
+  // Links nodes given in key order into a balanced tree and threads the empty links.
+  static std::uintptr_t linkBalanced(Node* const* nodes, size_type count)
+  {
+    if(count == 0)
+      return 0;
+    size_type middle = count / 2;
+    Node* node = nodes[middle];
+    node->left = linkBalanced(nodes, middle);
+    node->right = linkBalanced(nodes + middle + 1, count - middle - 1);
+    return child(node);
+  }
+
+  void attachSorted(std::vector<Node*>& nodes)
+  {
+    if(nodes.empty())
+      return;
+    head.left = linkBalanced(nodes.data(), nodes.size());
+    for(size_type i = 0; i < nodes.size(); ++i)
+    {
+      if(nodes[i]->left == 0)
+        nodes[i]->left = thread(i == 0 ? &head : nodes[i - 1]);
+      if(nodes[i]->right == 0)
+        nodes[i]->right = thread(i + 1 == nodes.size() ? &head : nodes[i + 1]);
+    }
+    size = nodes.size();
+  }
+
+  void steal(ThreadedTreeMap& other) noexcept
+  {
+    if(other.isEmpty())
+      return;
+    head.left = other.head.left;
+    size = other.size;
+    // only the extreme nodes thread back to the sentinel.
+    leftmost(target(head.left))->left = thread(&head);
+    rightmost(target(head.left))->right = thread(&head);
+    other.init();
+  }
+
+  Node* lookfor(const key_type& key) const
+  {
+    if(isEmpty())
+      return sentinel();
+    Node* current = target(head.left);
+    while(true)
+    {
+      if(current->data.first == key)
+        return current;
+      std::uintptr_t link = key < current->data.first ? current->left : current->right;
+      if(isThread(link))
+        return sentinel();
+      current = target(link);
+    }
+  }
+
+  void replaceLink(Node* parent, bool leftSide, std::uintptr_t link)
+  {
+    if(leftSide)
+      parent->left = link;
+    else
+      parent->right = link;
+  }
+
+public:
+  ThreadedTreeMap()
+  {
+    init();
+  }
+
+  explicit ThreadedTreeMap(const Allocator& alloc) : allocator(alloc)
+  {
+    init();
+  }
+
+  ThreadedTreeMap(std::initializer_list<value_type> list)
+  {
+    init();
+    for(auto& element : list)
+      operator[](element.first) = element.second;
+  }
+
+  ThreadedTreeMap(const ThreadedTreeMap& other)
+    : allocator(NodeTraits::select_on_container_copy_construction(other.allocator))
+  {
+    init();
+    std::vector<Node*> nodes;
+    nodes.reserve(other.size);
+    try
+    {
+      for(auto& element : other)
+        nodes.push_back(createNode(element));
+    }
+    catch(...)
+    {
+      for(auto node : nodes)
+        destroyNode(node);
+      throw;
+    }
+    attachSorted(nodes);
+  }
+
+  ThreadedTreeMap(ThreadedTreeMap&& other) noexcept : allocator(std::move(other.allocator))
+  {
+    init();
+    steal(other);
+  }
+
+  ~ThreadedTreeMap()
+  {
+    clear();
+  }
+
+  ThreadedTreeMap& operator=(const ThreadedTreeMap& other)
+  {
+    if(this == &other)
+      return *this;
+    ThreadedTreeMap copy(other);
+    return *this = std::move(copy);
+  }
+
+  ThreadedTreeMap& operator=(ThreadedTreeMap&& other) noexcept
+  {
+    if(this == &other)
+      return *this;
+    clear();
+    allocator = std::move(other.allocator);
+    steal(other);
+    return *this;
+  }
+
+  void clear()
+  {
+    if(isEmpty())
+      return;
+    bool bulk = BulkRelease<NodeAllocator>::available(allocator);
+    if(!bulk || !std::is_trivially_destructible<value_type>::value)
+    {
+      // threads give the in-order walk for free, no recursion or stack needed.
+      Node* node = leftmost(target(head.left));
+      while(node != &head)
+      {
+        Node* next = isThread(node->right) ? target(node->right) : leftmost(target(node->right));
+        if(bulk)
+          NodeTraits::destroy(allocator, node);
+        else
+          destroyNode(node);
+        node = next;
+      }
+    }
+    if(bulk)
+      BulkRelease<NodeAllocator>::release(allocator);
+    init();
+  }
+
+  bool isEmpty() const
+  {
+    return size == 0;
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    if(isEmpty())
+    {
+      Node* newNode = createNode(key);
+      newNode->left = thread(&head);
+      newNode->right = thread(&head);
+      head.left = child(newNode);
+      size++;
+      return newNode->data.second;
+    }
+    Node* current = target(head.left);
+    while(true)
+    {
+      if(key == current->data.first)
+        return current->data.second;
+      if(key < current->data.first)
+      {
+        if(!isThread(current->left))
+        {
+          current = target(current->left);
+          continue;
+        }
+        Node* newNode = createNode(key);
+        newNode->left = current->left;
+        newNode->right = thread(current);
+        current->left = child(newNode);
+        size++;
+        return newNode->data.second;
+      }
+      if(!isThread(current->right))
+      {
+        current = target(current->right);
+        continue;
+      }
+      Node* newNode = createNode(key);
+      newNode->right = current->right;
+      newNode->left = thread(current);
+      current->right = child(newNode);
+      size++;
+      return newNode->data.second;
+    }
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    if(isEmpty())
+      throw std::out_of_range("map is empty");
+    const_iterator position = find(key);
+    if(position == cend())
+      throw std::out_of_range("key does not exist");
+    return position->second;
+  }
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    if(isEmpty())
+      throw std::out_of_range("map is empty");
+    iterator position = find(key);
+    if(position == end())
+      throw std::out_of_range("key does not exist");
+    return position->second;
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    return const_iterator(lookfor(key), sentinel());
+  }
+
+  iterator find(const key_type& key)
+  {
+    return iterator(const_iterator(lookfor(key), sentinel()));
+  }
+
+  void remove(const key_type& key)
+  {
+    if(isEmpty())
+      throw std::out_of_range("cannot remove, empty list");
+    Node* parent = &head;
+    bool leftSide = true;
+    Node* removingNode = target(head.left);
+    while(!(removingNode->data.first == key))
+    {
+      leftSide = key < removingNode->data.first;
+      std::uintptr_t link = leftSide ? removingNode->left : removingNode->right;
+      if(isThread(link))
+        throw std::out_of_range("cannot remove, no such element");
+      parent = removingNode;
+      removingNode = target(link);
+    }
+
+    bool hasLeft = !isThread(removingNode->left);
+    bool hasRight = !isThread(removingNode->right);
+    if(!hasLeft && !hasRight)
+    {
+      // the parent inherits the thread pointing past the removed leaf.
+      replaceLink(parent, leftSide, leftSide ? removingNode->left : removingNode->right);
+    }
+    else if(!hasRight)
+    {
+      rightmost(target(removingNode->left))->right = removingNode->right;
+      replaceLink(parent, leftSide, removingNode->left);
+    }
+    else if(!hasLeft)
+    {
+      leftmost(target(removingNode->right))->left = removingNode->left;
+      replaceLink(parent, leftSide, removingNode->right);
+    }
+    else
+    {
+      // the successor takes the place of the removed node.
+      Node* successorParent = removingNode;
+      Node* successor = target(removingNode->right);
+      while(!isThread(successor->left))
+      {
+        successorParent = successor;
+        successor = target(successor->left);
+      }
+      if(successorParent != removingNode)
+      {
+        successorParent->left = isThread(successor->right) ? thread(successor) : successor->right;
+        successor->right = removingNode->right;
+      }
+      rightmost(target(removingNode->left))->right = thread(successor);
+      successor->left = removingNode->left;
+      replaceLink(parent, leftSide, child(successor));
+    }
+    destroyNode(removingNode);
+    size--;
+  }
+
+  void remove(const const_iterator& it)
+  {
+    if(it.currentNode == &head)
+      throw std::out_of_range("cannot remove, no such element");
+    remove(it.currentNode->data.first);
+  }
+
+  size_type getSize() const
+  {
+    return size;
+  }
+
+  bool operator==(const ThreadedTreeMap& other) const
+  {
+    if(size != other.size)
+      return false;
+    for(auto thisIt = begin(), otherIt = other.begin(); thisIt != end(); ++thisIt, ++otherIt)
+      if(!(otherIt->first == thisIt->first && otherIt->second == thisIt->second))
+        return false;
+    return true;
+  }
+
+  bool operator!=(const ThreadedTreeMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  iterator begin()
+  {
+    return cbegin();
+  }
+
+  iterator end()
+  {
+    return cend();
+  }
+
+  const_iterator cbegin() const
+  {
+    if(isEmpty())
+      return cend();
+    return const_iterator(leftmost(target(head.left)), sentinel());
+  }
+
+  const_iterator cend() const
+  {
+    return const_iterator(sentinel(), sentinel());
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Allocator>
+class ThreadedTreeMap<KeyType, ValueType, Allocator>::ConstIterator
+{
+public:
+  using reference = typename ThreadedTreeMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename ThreadedTreeMap::value_type;
+  using pointer = const typename ThreadedTreeMap::value_type*;
+  using difference_type = std::ptrdiff_t;
+
+  Node* currentNode;
+  Node* sentinel;
+
+  explicit ConstIterator() : currentNode(nullptr), sentinel(nullptr)
+  {}
+
+  ConstIterator(Node* pointer, Node* sentinel_) : currentNode(pointer), sentinel(sentinel_)
+  {}
+
+  ConstIterator(const ConstIterator& other) : currentNode(other.currentNode), sentinel(other.sentinel)
+  {}
+
+  ConstIterator& operator=(const ConstIterator& other) = default;
+
+  ConstIterator& operator++()
+  {
+    if(currentNode == sentinel)
+      throw std::out_of_range("cannot increment end");
+    std::uintptr_t link = currentNode->right;
+    currentNode = isThread(link) ? target(link) : leftmost(target(link));
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    auto tmp = *this;
+    operator++();
+    return tmp;
+  }
+
+  ConstIterator& operator--()
+  {
+    std::uintptr_t link = currentNode->left;
+    if(isThread(link))
+    {
+      if(target(link) == sentinel)
+        throw std::out_of_range(currentNode == sentinel ? "Cannot decrement, empty map"
+                                                         : "Cannot decrement begin");
+      currentNode = target(link);
+    }
+    else
+      currentNode = rightmost(target(link));
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    auto tmp = *this;
+    operator--();
+    return tmp;
+  }
+
+  reference operator*() const
+  {
+    if(currentNode == sentinel)
+      throw std::out_of_range("Cannot dereference end");
+    return currentNode->data;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return this->currentNode == other.currentNode;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Allocator>
+class ThreadedTreeMap<KeyType, ValueType, Allocator>::Iterator
+  : public ThreadedTreeMap<KeyType, ValueType, Allocator>::ConstIterator
+{
+public:
+  using reference = typename ThreadedTreeMap::reference;
+  using pointer = typename ThreadedTreeMap::value_type*;
+
+  explicit Iterator()
+  {}
+
+  Iterator(const ConstIterator& other)
+    : ConstIterator(other)
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  reference operator*() const
+  {
+    // ugly cast, yet reduces code duplication.
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_THREADEDTREEMAP_H */
@@ -0,0 +1,36 @@
+#ifndef AISDI_MAPS_TREAP_H
+#define AISDI_MAPS_TREAP_H
+
+#include <cstdint>
+
+namespace aisdi
+{
+
+namespace detail
+{
+
+// Source of random node priorities for the treaps. xorshift32 is good enough to keep
+// the expected depth logarithmic, and a fixed seed keeps tree shapes reproducible.
+class TreapPriorities
+{
+public:
+  TreapPriorities() : seed(2463534242u)
+  {}
+
+  std::uint32_t next()
+  {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+  }
+
+private:
+  std::uint32_t seed;
+};
+
+}
+
+}
+
+#endif /* AISDI_MAPS_TREAP_H */
@@ -2,14 +2,133 @@
 #define AISDI_MAPS_TREEMAP_H
 
 #include <cstddef>
+#include <functional>
 #include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
 #include <stdexcept>
+#include <type_traits>
 #include <utility>
+#include <vector>
+
+#include "BloomFilter.h"
+#include "Compare.h"
+#include "NodePool.h"
+#include "ThreadPool.h"
 
 namespace aisdi
 {
 
-template <typename KeyType, typename ValueType>
+// Conflict policies for combining maps, called with the values a key has in the left and right map.
+struct KeepLeft
+{
+  template <typename T>
+  const T& operator()(const T& left, const T&) const
+  {
+    return left;
+  }
+};
+
+struct KeepRight
+{
+  template <typename T>
+  const T& operator()(const T&, const T& right) const
+  {
+    return right;
+  }
+};
+
+// Node layouts of TreeMap. A node starts with its links and key, which is all a descent reads,
+// and keeps them within one cache line. InlineValues stores the whole item right after them.
+// OutOfLineValues stores a copy of the key and a pointer to the item, allocated on its own, so
+// nodes stay small however large the values are. AutoLayout picks one by the sizes involved.
+struct InlineValues {};
+struct OutOfLineValues {};
+struct AutoLayout {};
+
+namespace detail
+{
+
+const std::size_t CACHE_LINE = 64;
+
+// Smallest power of two covering bytes, starting from alignment and capped at a cache line.
+constexpr std::size_t lineAlignment(std::size_t bytes, std::size_t alignment = 1)
+{
+  return alignment >= bytes || alignment >= CACHE_LINE ? alignment : lineAlignment(bytes, 2 * alignment);
+}
+
+// What a TreeMap node holds after its links.
+template <typename Key, typename Value, bool OutOfLine>
+struct TreeNodeItem
+{
+  Value data;
+
+  TreeNodeItem() : data()
+  {}
+
+  template <typename... Args>
+  explicit TreeNodeItem(Args&&... args) : data(std::forward<Args>(args)...)
+  {}
+
+  const Key& key() const
+  {
+    return data.first;
+  }
+
+  Value& item()
+  {
+    return data;
+  }
+};
+
+template <typename Key, typename Value>
+struct TreeNodeItem<Key, Value, true>
+{
+  Key copy;
+  Value* data;
+
+  TreeNodeItem() : copy(), data(nullptr)
+  {}
+
+  explicit TreeNodeItem(Value* item) : copy(item->first), data(item)
+  {}
+
+  const Key& key() const
+  {
+    return copy;
+  }
+
+  Value& item()
+  {
+    return *data;
+  }
+};
+
+}
+
+// Shape of a tree as reported by TreeMap::shape(), the root has depth 0.
+struct TreeShape
+{
+  std::size_t height;
+  std::size_t maxDepth;
+  double averageDepth;
+  std::size_t leaves;
+  // number of nodes at every depth.
+  std::vector<std::size_t> depthHistogram;
+};
+
+// Work done by searches since the last reset, gathered only when AISDI_TREEMAP_STATS is defined.
+// A search is one walk down from the root, every lookup, insertion and removal does one.
+struct SearchStats
+{
+  std::size_t searches;
+  std::size_t comparisons;
+  std::size_t visits;
+};
+
+template <typename KeyType, typename ValueType, typename Compare = std::less<KeyType>,
+          typename Allocator = NodePool<std::pair<const KeyType, ValueType>>, typename Layout = AutoLayout>
 class TreeMap
 {
 public:
@@ -19,40 +138,841 @@ public:
   using size_type = std::size_t;
   using reference = value_type&;
   using const_reference = const value_type&;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
 
   class ConstIterator;
   class Iterator;
   using iterator = Iterator;
   using const_iterator = ConstIterator;
 private:
+    // Items move out of line when an inline node would not fit a cache line but one without the
+    // value does. The key is copied into the node then, so only trivially copyable keys qualify.
+    using ItemsOutOfLine = std::integral_constant<bool, std::is_same<Layout, OutOfLineValues>::value
+        || (std::is_same<Layout, AutoLayout>::value && std::is_trivially_copyable<key_type>::value
+            && sizeof(value_type) + 3 * sizeof(void*) > detail::CACHE_LINE
+            && sizeof(key_type) + 4 * sizeof(void*) <= detail::CACHE_LINE)>;
+
+public:
+    // True when nodes keep a pointer to the item instead of the item itself.
+    static const bool VALUES_OUT_OF_LINE = ItemsOutOfLine::value;
+
+private:
+
+    // The links come first, so the key follows them in the same cache line.
     struct Node
     {
-        value_type data;
         Node *left, *right, *parent;
+        detail::TreeNodeItem<key_type, value_type, ItemsOutOfLine::value> payload;
         Node() {}
-        Node(key_type key):data(std::make_pair(key, mapped_type{} )), left(nullptr), right(nullptr), parent(
-                nullptr){}
-        Node(value_type data):Node(data.first, data.second){}
-
-
+        template <typename... Args>
+        explicit Node(Args&&... args)
+          : left(nullptr), right(nullptr), parent(nullptr), payload(std::forward<Args>(args)...) {}
+
+        const key_type& key() const
+        {
+            return payload.key();
+        }
+
+        value_type& item()
+        {
+            return payload.item();
+        }
     };
-     Node* root;
+
+    // Nodes are built in slots aligned so that links and key never straddle cache lines, when the
+    // allocator can align that strictly. Aligning the slots rather than Node keeps the sentinel
+    // member, and with it the map, at the usual alignment.
+    static constexpr std::size_t SLOT_ALIGNMENT = OverAlignment<Allocator>::supported
+        && detail::lineAlignment(3 * sizeof(Node*) + sizeof(key_type)) > alignof(Node)
+        ? detail::lineAlignment(3 * sizeof(Node*) + sizeof(key_type)) : alignof(Node);
+    using NodeSlot = typename std::aligned_storage<sizeof(Node), SLOT_ALIGNMENT>::type;
+    using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<NodeSlot>;
+    using NodeTraits = std::allocator_traits<NodeAllocator>;
+    using ItemAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<value_type>;
+    using ItemTraits = std::allocator_traits<ItemAllocator>;
+    using KeyOrder = KeyCompare<Compare, key_type>;
+
+    // the sentinel lives inside the map, so creating and moving maps never allocates.
+    Node head;
+    Node* root;
     size_type size;
+    Compare comp;
+    NodeAllocator allocator;
+    // rebuilt by refreshFilter() on insertion and removal once stale, lookups only read it.
+    BloomFilter<key_type> filter;
+#ifdef AISDI_TREEMAP_STATS
+    mutable SearchStats stats = SearchStats();
+#endif
+
+    // The counters vanish along with the calls unless stats are enabled.
+    void countSearch() const
+    {
+#ifdef AISDI_TREEMAP_STATS
+        stats.searches++;
+#endif
+    }
+
+    void countComparison(bool visit = true) const
+    {
+#ifdef AISDI_TREEMAP_STATS
+        stats.comparisons++;
+        if(visit)
+            stats.visits++;
+#else
+        (void)visit;
+#endif
+    }
+
+    template <typename... Args>
+    Node* createNode(Args&&... args)
+    {
+        Node* node = static_cast<Node*>(static_cast<void*>(NodeTraits::allocate(allocator, 1)));
+        try
+        {
+            constructNode(node, ItemsOutOfLine(), std::forward<Args>(args)...);
+        }
+        catch(...)
+        {
+            NodeTraits::deallocate(allocator, slotOf(node), 1);
+            throw;
+        }
+        return node;
+    }
+
+    template <typename... Args>
+    void constructNode(Node* node, std::false_type, Args&&... args)
+    {
+        NodeTraits::construct(allocator, node, std::forward<Args>(args)...);
+    }
+
+    // The item comes from the same allocator, which has to exist first for a pool to share its slabs.
+    template <typename... Args>
+    void constructNode(Node* node, std::true_type, Args&&... args)
+    {
+        ItemAllocator items(allocator);
+        value_type* item = ItemTraits::allocate(items, 1);
+        try
+        {
+            ItemTraits::construct(items, item, std::forward<Args>(args)...);
+            try
+            {
+                NodeTraits::construct(allocator, node, item);
+            }
+            catch(...)
+            {
+                ItemTraits::destroy(items, item);
+                throw;
+            }
+        }
+        catch(...)
+        {
+            ItemTraits::deallocate(items, item, 1);
+            throw;
+        }
+    }
+
+    static NodeSlot* slotOf(Node* node)
+    {
+        return static_cast<NodeSlot*>(static_cast<void*>(node));
+    }
+
+    // Without deallocating, the memory is left to be released in bulk.
+    void destroyNode(Node* node, bool deallocate = true)
+    {
+        destroyItem(node, deallocate, ItemsOutOfLine());
+        NodeTraits::destroy(allocator, node);
+        if(deallocate)
+            NodeTraits::deallocate(allocator, slotOf(node), 1);
+    }
+
+    void destroyItem(Node*, bool, std::false_type)
+    {}
+
+    void destroyItem(Node* node, bool deallocate, std::true_type)
+    {
+        ItemAllocator items(allocator);
+        value_type* item = &node->item();
+        ItemTraits::destroy(items, item);
+        if(deallocate)
+            ItemTraits::deallocate(items, item, 1);
+    }
+
     void init()
     {
-        root = new Node();
+        root = &head;
         root->right = root;
         root->left = root;
         root->parent = nullptr;
         size = 0;
 
     }
+
+    void steal(TreeMap& other) noexcept
+    {
+        if(other.isEmpty())
+            return;
+        root->left = other.root->left;
+        root->right = nullptr;
+        root->left->parent = root;
+        size = other.size;
+        other.root->left = other.root;
+        other.root->right = other.root;
+        other.size = 0;
+    }
+
+    // Links nodes given in key order into a perfectly balanced subtree, no comparisons needed.
+    static Node* linkBalanced(Node* const* nodes, size_type count, Node* parent)
+    {
+        if(count == 0)
+            return nullptr;
+        size_type middle = count / 2;
+        Node* node = nodes[middle];
+        node->parent = parent;
+        node->left = linkBalanced(nodes, middle, node);
+        node->right = linkBalanced(nodes + middle + 1, count - middle - 1, node);
+        return node;
+    }
+
+    // Creates nodes from a range sorted by key, the only comparisons done are the ones validating the order.
+    template <typename InputIt>
+    std::vector<Node*> createSorted(InputIt first, InputIt last)
+    {
+        std::vector<Node*> nodes;
+        try
+        {
+            for(; first != last; ++first)
+            {
+                if(!nodes.empty() && !comp(nodes.back()->key(), (*first).first))
+                    throw std::invalid_argument("keys are not sorted");
+                nodes.push_back(nullptr);
+                nodes.back() = createNode(*first);
+            }
+        }
+        catch(...)
+        {
+            for(auto node : nodes)
+                if(node != nullptr)
+                    destroyNode(node);
+            throw;
+        }
+        return nodes;
+    }
+
+    void attachSorted(std::vector<Node*>& nodes)
+    {
+        if(nodes.empty())
+            return;
+        root->left = linkBalanced(nodes.data(), nodes.size(), root);
+        root->right = nullptr;
+        size = nodes.size();
+    }
+
+    // Walks both maps in order and builds the result with the sorted builder, O(n + m) overall.
+    // The flags choose which keys survive: only in left, only in right, in both.
+    template <typename Policy>
+    static TreeMap combine(const TreeMap& left, const TreeMap& right,
+                           bool leftOnly, bool rightOnly, bool both, Policy& policy)
+    {
+        TreeMap result(left.comp);
+        std::vector<Node*> nodes;
+        try
+        {
+            auto leftIt = left.begin();
+            auto rightIt = right.begin();
+            while(leftIt != left.end() || rightIt != right.end())
+            {
+                if(rightIt == right.end() || (leftIt != left.end() && left.comp(leftIt->first, rightIt->first)))
+                {
+                    if(!leftOnly && rightIt == right.end())
+                        break;
+                    if(leftOnly)
+                    {
+                        nodes.push_back(nullptr);
+                        nodes.back() = result.createNode(*leftIt);
+                    }
+                    ++leftIt;
+                }
+                else if(leftIt == left.end() || left.comp(rightIt->first, leftIt->first))
+                {
+                    if(!rightOnly && leftIt == left.end())
+                        break;
+                    if(rightOnly)
+                    {
+                        nodes.push_back(nullptr);
+                        nodes.back() = result.createNode(*rightIt);
+                    }
+                    ++rightIt;
+                }
+                else
+                {
+                    if(both)
+                    {
+                        nodes.push_back(nullptr);
+                        nodes.back() = result.createNode(value_type(leftIt->first, policy(leftIt->second, rightIt->second)));
+                    }
+                    ++leftIt;
+                    ++rightIt;
+                }
+            }
+        }
+        catch(...)
+        {
+            for(auto node : nodes)
+                if(node != nullptr)
+                    result.destroyNode(node);
+            throw;
+        }
+        result.attachSorted(nodes);
+        return result;
+    }
+
+    // Frees the whole tree, already detached from the sentinel. With an exclusively owned node pool
+    // the slabs are dropped at once and nodes are only visited when their values need destructors.
+    void destroy(Node* node)
+    {
+        bool bulk = BulkRelease<NodeAllocator>::available(allocator);
+        if(bulk && std::is_trivially_destructible<value_type>::value)
+            node = nullptr;
+        // iterative post-order walk, node must already be detached from its parent.
+        while(node != nullptr)
+        {
+            if(node->left != nullptr)
+                node = node->left;
+            else if(node->right != nullptr)
+                node = node->right;
+            else
+            {
+                Node* parent = node->parent;
+                if(parent != nullptr)
+                {
+                    if(parent->left == node)
+                        parent->left = nullptr;
+                    else
+                        parent->right = nullptr;
+                }
+                destroyNode(node, !bulk);
+                node = parent;
+            }
+        }
+        if(bulk)
+            BulkRelease<NodeAllocator>::release(allocator);
+    }
+    void noteInserted(const key_type& key)
+    {
+        size++;
+        if(filter.isEnabled())
+        {
+            filter.insert(key);
+            refreshFilter();
+        }
+    }
+
+    // Returns the node holding key, when missing it is created as a leaf below starting.
+    Node* insertBelow(Node* starting, const key_type& key)
+    {
+        if(isEmpty())
+        {
+            Node *newNode = createNode(key, mapped_type());
+            newNode->parent = root;
+            root->left = newNode;
+            root->right = nullptr;
+            noteInserted(key);
+            return newNode;
+        }
+        Node *current;
+        bool left;
+        Node *found = descend(starting, key, current, left);
+        if(found != nullptr)
+            return found;
+        Node *newNode = createNode(key, mapped_type());
+        newNode->parent = current;
+        if(left)
+            current->left = newNode;
+        else
+            current->right = newNode;
+        noteInserted(key);
+        return newNode;
+    }
+
+    // Node following node in key order, the sentinel after the last one.
+    static Node* successor(Node* node)
+    {
+        if(node->right != nullptr)
+        {
+            node = node->right;
+            while(node->left != nullptr)
+                node = node->left;
+            return node;
+        }
+        while(node == node->parent->right)
+            node = node->parent;
+        return node->parent;
+    }
+
+    // Node preceding node in key order, nullptr before the first one. The sentinel is preceded by the last one.
+    Node* predecessor(Node* node) const
+    {
+        if(node == root || node->left != nullptr)
+        {
+            node = node->left;
+            while(node->right != nullptr)
+                node = node->right;
+            return node;
+        }
+        while(node->parent != root && node == node->parent->left)
+            node = node->parent;
+        return node->parent == root ? nullptr : node->parent;
+    }
+
+    // Hinted insertion as std::map does it: a key falling right before or right after hint is linked
+    // next to it after at most three comparisons, other keys are searched for from the hint.
+    // Either way a new node too deep is fixed by rebuildIfDeep(), so sorted streams stay O(1) each.
+    Node* insertNear(Node* hint, const key_type& key)
+    {
+        if(isEmpty())
+            return insertBelow(root->left, key);
+        Node* before = hint;
+        Node* after = hint;
+        if(hint == root)
+            before = predecessor(hint);
+        else
+        {
+            countComparison();
+            if(comp(hint->key(), key))
+                after = successor(hint);
+            else
+            {
+                countComparison();
+                if(!comp(key, hint->key()))
+                {
+                    countSearch();
+                    return hint;
+                }
+                before = predecessor(hint);
+            }
+        }
+        bool adjacent = true;
+        if(before != nullptr && before != hint)
+        {
+            countComparison();
+            adjacent = comp(before->key(), key);
+        }
+        if(adjacent && after != root && after != hint)
+        {
+            countComparison();
+            adjacent = comp(key, after->key());
+        }
+        Node* newNode;
+        if(adjacent)
+        {
+            countSearch();
+            newNode = createNode(key, mapped_type());
+            // the gap between two neighbours always has a free slot: right of before or left of after.
+            if(before != nullptr && before->right == nullptr)
+            {
+                newNode->parent = before;
+                before->right = newNode;
+            }
+            else
+            {
+                newNode->parent = after;
+                after->left = newNode;
+            }
+            noteInserted(key);
+        }
+        else
+        {
+            size_type oldSize = size;
+            newNode = insertBelow(fingerStart(hint, key), key);
+            if(size == oldSize)
+                return newNode;
+        }
+        rebuildIfDeep(newNode);
+        return newNode;
+    }
+
+    // Levels of a perfectly balanced tree holding all items.
+    size_type optimalHeight() const
+    {
+        size_type levels = 0;
+        for(size_type count = size; count > 0; count >>= 1)
+            levels++;
+        return levels;
+    }
+
+    // Scapegoat step: once node lies deeper than twice the optimal height, the lowest ancestor with
+    // a child holding over two thirds of its subtree is relinked balanced. Such an ancestor always
+    // exists at that depth, and the relinking amortizes to O(log n) per insertion, with no comparisons.
+    // A tree grown lopsided by plain insertions may need more than that, then all of it is relinked.
+    void rebuildIfDeep(Node* node)
+    {
+        if(!deeperThan(node, 2 * optimalHeight()))
+            return;
+        size_type below = 1;
+        for(Node* current = node; current->parent != root; current = current->parent)
+        {
+            Node* parent = current->parent;
+            size_type total = below + 1 + countBelow(current == parent->left ? parent->right : parent->left);
+            if(3 * below > 2 * total)
+            {
+                relinkBalanced(parent, total);
+                break;
+            }
+            below = total;
+        }
+        if(deeperThan(node, 2 * optimalHeight()))
+            rebalance();
+    }
+
+    // Relinks the count nodes below top into a balanced subtree in its place. Without memory for
+    // the index the shape is simply kept, it only costs speed.
+    void relinkBalanced(Node* top, size_type count)
+    {
+        std::vector<Node*> nodes;
+        try
+        {
+            nodes.reserve(count);
+        }
+        catch(const std::bad_alloc&)
+        {
+            return;
+        }
+        auto collect = [&nodes](Node* node) { nodes.push_back(node); };
+        forEachNodeBelow(top, collect);
+        Node* parent = top->parent;
+        bool left = parent->left == top;
+        Node* subtree = linkBalanced(nodes.data(), nodes.size(), parent);
+        if(left)
+            parent->left = subtree;
+        else
+            parent->right = subtree;
+    }
+
+    static size_type countBelow(Node* node)
+    {
+        size_type count = 0;
+        auto add = [&count](Node*) { count++; };
+        forEachNodeBelow(node, add);
+        return count;
+    }
+
+    // Walks down from current towards key, returning its node or nullptr. On a miss parent is the
+    // last node visited and left tells on which side of it key belongs. One comparison per level.
+    Node* descend(Node* current, const key_type& key, Node*& parent, bool& left) const
+    {
+        countSearch();
+        return descend(current, key, parent, left, std::integral_constant<bool, KeyOrder::threeWay>());
+    }
+
+    Node* descend(Node* current, const key_type& key, Node*& parent, bool& left, std::true_type) const
+    {
+        parent = nullptr;
+        left = false;
+        while(current != nullptr)
+        {
+            countComparison();
+            int order = KeyOrder::compare(comp, key, current->key());
+            if(order == 0)
+                return current;
+            parent = current;
+            left = order < 0;
+            current = left ? current->left : current->right;
+        }
+        return nullptr;
+    }
+
+    // Only less-than available: go down to a leaf remembering the smallest key not less than key,
+    // which is the only node that may be equal to it.
+    Node* descend(Node* current, const key_type& key, Node*& parent, bool& left, std::false_type) const
+    {
+        Node* candidate = nullptr;
+        parent = nullptr;
+        left = false;
+        while(current != nullptr)
+        {
+            countComparison();
+            parent = current;
+            left = !comp(current->key(), key);
+            if(left)
+                candidate = current;
+            current = left ? current->left : current->right;
+        }
+        if(candidate == nullptr)
+            return nullptr;
+        countComparison(false);
+        if(!comp(key, candidate->key()))
+            return candidate;
+        return nullptr;
+    }
+
+    // Finger search: climbs from hint only until key falls within the current subtree's key range.
+    // For keys close to the hint this touches O(log distance) nodes on a balanced shape. The climb
+    // gives up after twice the optimal height, past that starting from the root is no worse.
+    Node* fingerStart(Node* hint, const key_type& key) const
+    {
+        if(hint == root)
+            return root->left;
+        Node* current = hint;
+        countComparison(false);
+        bool searchingLeft = comp(key, current->key());
+        for(size_type steps = 2 * optimalHeight(); current->parent != root; steps--)
+        {
+            if(steps == 0)
+                return root->left;
+            Node* parent = current->parent;
+            if(searchingLeft && current == parent->right)
+            {
+                countComparison();
+                if(comp(parent->key(), key))
+                    break;
+            }
+            if(!searchingLeft && current == parent->left)
+            {
+                countComparison();
+                if(comp(key, parent->key()))
+                    break;
+            }
+            current = parent;
+        }
+        return current;
+    }
+
+    // First node, in key order, whose key is not before(key), or the sentinel. before has to hold
+    // for a prefix of the keys in order, so one walk down the tree finds the boundary.
+    template <typename Before>
+    Node* partitionPoint(Before before) const
+    {
+        countSearch();
+        Node* result = root;
+        Node* current = root->left;
+        while(current != nullptr && current != root)
+        {
+            countComparison();
+            if(before(current->key()))
+                current = current->right;
+            else
+            {
+                result = current;
+                current = current->left;
+            }
+        }
+        return result;
+    }
+
+    template <typename Function>
+    static void forEachBelow(Node* node, Function& fn)
+    {
+        auto visit = [&fn](Node* current) { fn(current->item()); };
+        forEachNodeBelow(node, visit);
+    }
+
+    // In-order walk of the subtree below node along the parent links.
+    template <typename Function>
+    static void forEachNodeBelow(Node* node, Function& fn)
+    {
+        if(node == nullptr)
+            return;
+        Node* const top = node;
+        while(node->left != nullptr)
+            node = node->left;
+        while(node != nullptr)
+        {
+            fn(node);
+            if(node->right != nullptr)
+            {
+                node = node->right;
+                while(node->left != nullptr)
+                    node = node->left;
+                continue;
+            }
+            while(node != top && node == node->parent->right)
+                node = node->parent;
+            node = node == top ? nullptr : node->parent;
+        }
+    }
+
+    // Levels of the tree split into parallel tasks: 2^levels pieces when balanced, eight per thread.
+    static size_type forkLevels(const ThreadPool& pool)
+    {
+        size_type levels = 3;
+        for(size_type threads = 1; threads < pool.getThreadCount(); threads *= 2)
+            levels++;
+        return levels;
+    }
+
+    // Left subtrees go to the pool, the node and its right subtree stay with the calling thread.
+    template <typename Function>
+    static void forEachParallel(Node* node, size_type levels, Function& fn, ThreadPool& pool)
+    {
+        if(node == nullptr)
+            return;
+        if(levels == 0)
+        {
+            forEachBelow(node, fn);
+            return;
+        }
+        TaskGroup group(pool);
+        group.run([node, levels, &fn, &pool]() { forEachParallel(node->left, levels - 1, fn, pool); });
+        fn(node->item());
+        forEachParallel(node->right, levels - 1, fn, pool);
+        group.wait();
+    }
+
+    template <typename T, typename Accumulate, typename Combine>
+    static T reduceParallel(Node* node, size_type levels, const T& init, Accumulate& accumulate,
+                            Combine& combine, ThreadPool& pool)
+    {
+        if(node == nullptr)
+            return init;
+        if(levels == 0)
+        {
+            T result = init;
+            auto add = [&result, &accumulate](const value_type& item) { result = accumulate(result, item); };
+            forEachBelow(node, add);
+            return result;
+        }
+        T left = init;
+        TaskGroup group(pool);
+        group.run([node, levels, &left, &init, &accumulate, &combine, &pool]() {
+            left = reduceParallel(node->left, levels - 1, init, accumulate, combine, pool);
+        });
+        T right = accumulate(init, node->item());
+        right = combine(right, reduceParallel(node->right, levels - 1, init, accumulate, combine, pool));
+        group.wait();
+        return combine(left, right);
+    }
+
+    // Unlinks and frees node, its in-order successor takes its place when it has two children.
+    void removeNode(Node* removingNode)
+    {
+        if(filter.isEnabled())
+            filter.noteRemoval();
+        if(removingNode->left == nullptr)
+        {
+            disconnectNode(removingNode,removingNode->right);
+
+        }else if(removingNode->right == nullptr)
+            disconnectNode(removingNode,removingNode->left);
+        else
+        {
+            auto tmp = removingNode->right;
+
+            while (tmp->left != nullptr)
+                tmp = tmp->left;
+            if(tmp->parent != removingNode) {
+                disconnectNode(tmp, tmp->right);
+                tmp->right = removingNode->right;
+                tmp->right->parent = tmp;
+            }
+            disconnectNode(removingNode, tmp);
+            tmp->left = removingNode->left;
+            tmp->left->parent = tmp;
+
+
+        }
+        destroyNode(removingNode);
+        size--;
+        if(isEmpty())
+        {
+            root->left=root;
+
+        }
+        refreshFilter();
+    }
+
+    // Tells whether node lies more than limit levels below the root, climbing at most limit steps.
+    bool deeperThan(const Node* node, size_type limit) const
+    {
+        for(size_type depth = 0; node->parent != root; node = node->parent)
+            if(++depth > limit)
+                return true;
+        return false;
+    }
+
+    // Relinks all nodes into a perfectly balanced tree, nothing is allocated but the index.
+    void rebalance()
+    {
+        if(isEmpty())
+            return;
+        std::vector<Node*> nodes;
+        nodes.reserve(size);
+        for(auto it = cbegin(); it != cend(); ++it)
+            nodes.push_back(it.currentNode);
+        root->left = linkBalanced(nodes.data(), nodes.size(), root);
+    }
+
+    bool filteredOut(const key_type& key) const
+    {
+        return filter.isEnabled() && !filter.mayContain(key);
+    }
+
+    void refilter()
+    {
+        BloomFilter<key_type> rebuilt;
+        rebuilt.reset(2 * size);
+        for(auto it = cbegin(); it != cend(); ++it)
+            rebuilt.insert(it->first);
+        filter = std::move(rebuilt);
+    }
+
+    // Rebuilds the filter once removals or growth made it stale. The old one still holds every key,
+    // so it is kept when there is no memory for a new one.
+    void refreshFilter()
+    {
+        if(!filter.isEnabled() || !filter.needsRebuild(size))
+            return;
+        try
+        {
+            refilter();
+        }
+        catch(const std::bad_alloc&)
+        {
+        }
+    }
+
+    // Items are moved into relocated nodes only when nothing can throw once the first one has moved.
+    using RelocatesByMove = std::integral_constant<bool, !ItemsOutOfLine::value
+        && std::is_nothrow_move_constructible<value_type>::value>;
+
+    static value_type&& relocated(value_type& item, std::true_type)
+    {
+        return std::move(item);
+    }
+
+    static const value_type& relocated(value_type& item, std::false_type)
+    {
+        return item;
+    }
+
+    template <typename Keys, typename KeyOf>
+    void checkIncreasing(const Keys& keys, KeyOf keyOf) const
+    {
+        auto previous = keys.begin();
+        if(previous == keys.end())
+            return;
+        for(auto current = std::next(previous); current != keys.end(); previous = current++)
+            if(!comp(keyOf(*previous), keyOf(*current)))
+                throw std::invalid_argument("keys are not sorted");
+    }
+
 public:
   TreeMap()
   {
       init();
   }
 
+  explicit TreeMap(const Allocator& alloc) : allocator(alloc)
+  {
+      init();
+  }
+
+  explicit TreeMap(const Compare& comparator, const Allocator& alloc = Allocator())
+    : comp(comparator), allocator(alloc)
+  {
+      init();
+  }
+
   TreeMap(std::initializer_list<value_type> list)
   {
     init();
@@ -62,45 +982,216 @@ public:
   }
 
   TreeMap(const TreeMap& other)
+    : comp(other.comp), allocator(NodeTraits::select_on_container_copy_construction(other.allocator)),
+      filter(other.filter)
   {
       init();
-      for(auto element : other)
-          operator[](element.first) = element.second;
+      auto nodes = createSorted(other.begin(), other.end());
+      attachSorted(nodes);
+  }
+
+  template <typename InputIt>
+  static TreeMap fromSorted(InputIt first, InputIt last, const Compare& comparator = Compare())
+  {
+      TreeMap result(comparator);
+      auto nodes = result.createSorted(first, last);
+      result.attachSorted(nodes);
+      return result;
+  }
+
+  // Applies a batch of changes: removes the keys of deletes, skipping missing ones, then sets the
+  // items of upserts, so a key in both keeps its new value. Both have to be strictly increasing.
+  // Each key is looked up from the previous one with a finger search, which makes k changes spread
+  // over n items cost O(k log(n / k)) on a balanced tree instead of O(k log n). New keys landing
+  // next to the previous one, as a run appended past the end does, take O(1) comparisons each, and
+  // subtrees grown too deep are relinked balanced on the way.
+  template <typename Upserts, typename Deletes>
+  void applyBatch(const Upserts& upserts, const Deletes& deletes)
+  {
+      checkIncreasing(deletes, [](const key_type& key) -> const key_type& { return key; });
+      checkIncreasing(upserts, [](const value_type& item) -> const key_type& { return item.first; });
+
+      Node* finger = root;
+      for(const key_type& key : deletes)
+      {
+          if(isEmpty())
+              break;
+          Node* node = lookfor(fingerStart(finger, key), key).currentNode;
+          if(node == root)
+              continue;
+          finger = std::next(const_iterator(node)).currentNode;
+          removeNode(node);
+      }
+
+      finger = root;
+      for(const auto& item : upserts)
+      {
+          Node* node = insertNear(finger, item.first);
+          node->item().second = item.second;
+          finger = node;
+      }
   }
 
-  TreeMap(TreeMap&& other)
+  // Moves all items into new nodes laid out in key order in a fresh block of memory and links them
+  // into a balanced tree, which brings the locality of a just built map back after long churn.
+  // With NodePool the map gets a pool of its own and the old slabs are freed at once. Items are
+  // copied instead of moved when moving could throw, a failure leaves the map as it was.
+  // Invalidates all iterators and references.
+  void compact()
   {
+      if(isEmpty())
+          return;
+      TreeMap fresh(comp, Allocator(NodeTraits::select_on_container_copy_construction(allocator)));
+      BulkRelease<NodeAllocator>::reserve(fresh.allocator, size);
+      std::vector<Node*> nodes;
+      nodes.reserve(size);
+      // all slots are taken up front, so moving items is the last step and cannot fail halfway.
+      try
+      {
+          for(size_type i = 0; i < size; ++i)
+              nodes.push_back(static_cast<Node*>(static_cast<void*>(NodeTraits::allocate(fresh.allocator, 1))));
+      }
+      catch(...)
+      {
+          for(auto node : nodes)
+              NodeTraits::deallocate(fresh.allocator, slotOf(node), 1);
+          throw;
+      }
+      size_type built = 0;
+      try
+      {
+          for(auto it = begin(); it != end(); ++it, ++built)
+              fresh.constructNode(nodes[built], ItemsOutOfLine(), relocated(*it, RelocatesByMove()));
+      }
+      catch(...)
+      {
+          for(size_type i = 0; i < nodes.size(); ++i)
+              if(i < built)
+                  fresh.destroyNode(nodes[i]);
+              else
+                  NodeTraits::deallocate(fresh.allocator, slotOf(nodes[i]), 1);
+          throw;
+      }
+      fresh.attachSorted(nodes);
+      fresh.filter = std::move(filter);
+      *this = std::move(fresh);
+  }
+
+  // Builds a map from items in any order, of items with equal keys the last one wins. The items
+  // are sorted on pool by address, so they are moved only once, into nodes taken from a single
+  // block when the allocator can reserve one, which are then linked into a balanced tree.
+  static TreeMap build(std::vector<value_type>&& items, const Compare& comparator = Compare(),
+                       ThreadPool& pool = ThreadPool::shared())
+  {
+      TreeMap result(comparator);
+      std::vector<value_type*> order;
+      order.reserve(items.size());
+      for(auto& item : items)
+          order.push_back(&item);
+      // ties go by position, so the last of equal keys ends each run.
+      parallelSort(order.begin(), order.end(), [&comparator](const value_type* left, const value_type* right) {
+          if(comparator(left->first, right->first))
+              return true;
+          return !comparator(right->first, left->first) && left < right;
+      }, pool);
+
+      auto lastOfRun = [&order, &comparator](size_type i) {
+          return i + 1 == order.size() || comparator(order[i]->first, order[i + 1]->first);
+      };
+      size_type unique = 0;
+      for(size_type i = 0; i < order.size(); ++i)
+          if(lastOfRun(i))
+              unique++;
+      BulkRelease<NodeAllocator>::reserve(result.allocator, unique);
+      if(ItemsOutOfLine::value)
+      {
+          ItemAllocator items(result.allocator);
+          BulkRelease<ItemAllocator>::reserve(items, unique);
+      }
+
+      std::vector<Node*> nodes;
+      nodes.reserve(unique);
+      try
+      {
+          for(size_type i = 0; i < order.size(); ++i)
+              if(lastOfRun(i))
+                  nodes.push_back(result.createNode(std::move(*order[i])));
+      }
+      catch(...)
+      {
+          for(auto node : nodes)
+              result.destroyNode(node);
+          throw;
+      }
+      result.attachSorted(nodes);
+      items.clear();
+      return result;
+  }
+
+  // Keys present in either map. policy(leftValue, rightValue) resolves keys present in both.
+  template <typename Policy = KeepLeft>
+  static TreeMap set_union(const TreeMap& left, const TreeMap& right, Policy policy = Policy())
+  {
+      return combine(left, right, true, true, true, policy);
+  }
+
+  // Keys present in both maps, with values resolved by policy(leftValue, rightValue).
+  template <typename Policy = KeepLeft>
+  static TreeMap set_intersection(const TreeMap& left, const TreeMap& right, Policy policy = Policy())
+  {
+      return combine(left, right, false, false, true, policy);
+  }
+
+  // Keys of left that are missing in right.
+  static TreeMap set_difference(const TreeMap& left, const TreeMap& right)
+  {
+      KeepLeft policy;
+      return combine(left, right, true, false, false, policy);
+  }
+
+  // Adds all items of other, policy(ourValue, otherValue) resolves keys present in both maps.
+  template <typename Policy = KeepLeft>
+  void merge(const TreeMap& other, Policy policy = Policy())
+  {
+      bool filtered = usesBloomFilter();
+      *this = set_union(*this, other, policy);
+      if(filtered)
+          refilter();
+  }
+
+  TreeMap(TreeMap&& other) noexcept
+    : comp(other.comp), allocator(std::move(other.allocator)), filter(std::move(other.filter))
+  {
+      other.filter.release();
       init();
-      root=other.root;
-      size=other.size;
-      other.root= nullptr;
-      other.size=0;
+      steal(other);
+  }
+
+  ~TreeMap()
+  {
+      clear();
   }
 
   TreeMap& operator=(const TreeMap& other)
   {
     if(root==other.root)
         return *this;
-      if(!isEmpty())
-      for(auto it = begin();it!=end();++it)
-          remove(it);
-
-         for(auto element : other)
-             operator[](element.first) = element.second;
-      return  *this;
+      // the copy gets its own slabs, so ours can be released as a whole.
+      TreeMap copy(other);
+      return *this = std::move(copy);
 
   }
 
-  TreeMap& operator=(TreeMap&& other)
+  TreeMap& operator=(TreeMap&& other) noexcept
   {
-    if(root==other.root)
+    if(this == &other)
         return *this;
-      for(auto it = begin();it!=end();++it)
-          remove(it);
-      root=other.root;
-      size=other.size;
-      other.root= nullptr;
-      other.size=0;
+      clear();
+      comp = other.comp;
+      allocator = std::move(other.allocator);
+      filter = std::move(other.filter);
+      other.filter.release();
+      steal(other);
       return *this;
   }
 
@@ -109,37 +1200,52 @@ public:
     return(size == 0);
   }
 
+  void clear()
+  {
+      if(isEmpty())
+          return;
+      root->left->parent = nullptr;
+      destroy(root->left);
+      root->left = root;
+      root->right = root;
+      size = 0;
+      if(filter.isEnabled())
+          filter.reset(0);
+  }
+
+  // Keeps a Bloom filter of the keys, so that most lookups of missing keys end before descending.
+  // Only for the natural order, where equivalent keys are equal and so hash alike.
+  void useBloomFilter(bool enabled)
+  {
+      static_assert(std::is_same<Compare, std::less<key_type>>::value,
+                    "the Bloom filter needs keys in their natural order");
+      static_assert(std::is_default_constructible<std::hash<key_type>>::value, "keys have to be hashable");
+      if(!enabled)
+          filter.release();
+      else if(!filter.isEnabled())
+          refilter();
+  }
+
+  bool usesBloomFilter() const
+  {
+      return filter.isEnabled();
+  }
+
   mapped_type& operator[](const key_type& key)
   {
-    if(isEmpty())
-    {
-         Node *newNode = new Node(key);
-        newNode->parent = root;
-        root->left = newNode;
-        root->right = nullptr;
-        size++;
-        return newNode->data.second;
-    }
-      Node* next = root->left;
-      Node *current = next;
-      while(next!= nullptr)
-      {
-          current = next;
-          if(key == current->data.first)
-              return current->data.second;
-          if(key < current->data.first)
-              next = current->left;
-          else
-              next = current->right;
-      }
-      Node *newNode = new Node(key);
-      newNode->parent = current;
-      if(key < current->data.first)
-           current->left = newNode;
-      else
-          current->right = newNode;
-      size++;
-      return newNode->data.second;
+      return insertBelow(root->left, key)->item().second;
+  }
+
+  // Inserts key with value unless it is already present, searching from hint. Returns the key's position.
+  // A key right before or after hint takes amortized O(1), so sorted input can be fed with end() or
+  // the previous result as the hint.
+  iterator insert(const const_iterator& hint, const key_type& key, const mapped_type& value)
+  {
+      size_type oldSize = size;
+      Node* node = insertNear(hint.currentNode, key);
+      if(size != oldSize)
+          node->item().second = value;
+      return const_iterator(node);
   }
 
   const mapped_type& valueOf(const key_type& key) const
@@ -164,7 +1270,7 @@ public:
 
   const_iterator find(const key_type& key) const
   {
-      if(isEmpty())
+      if(isEmpty() || filteredOut(key))
           return cend();
       return lookfor(root->left, key);
 
@@ -172,50 +1278,75 @@ public:
 
   iterator find(const key_type& key)
   {
-      if(isEmpty())
+      if(isEmpty() || filteredOut(key))
           return end();
       return lookfor(root->left, key);
   }
 
-  void remove(const key_type& key)
+  // Same as find, but the search starts at hint, cheap when key is close to it.
+  const_iterator find(const const_iterator& hint, const key_type& key) const
   {
-      if(isEmpty())
-          throw std::out_of_range("cannot remove, empty list");
-      auto removingNode = find(key).currentNode;
-      if(removingNode==root)
-          throw std::out_of_range("cannot remove, no such element");
-      if(removingNode->left == nullptr)
-      {
-          disconnectNode(removingNode,removingNode->right);
+      if(isEmpty() || filteredOut(key))
+          return cend();
+      return lookfor(fingerStart(hint.currentNode, key), key);
+  }
 
-      }else if(removingNode->right == nullptr)
-          disconnectNode(removingNode,removingNode->left);
-      else
-      {
-          auto tmp = removingNode->right;
-
-          while (tmp->left != nullptr)
-              tmp = tmp->left;
-          if(tmp->parent != removingNode) {
-              disconnectNode(tmp, tmp->right);
-              tmp->right = removingNode->right;
-              tmp->right->parent = tmp;
-          }
-          disconnectNode(removingNode, tmp);
-          tmp->left = removingNode->left;
-          tmp->left->parent = tmp;
+  iterator find(const const_iterator& hint, const key_type& key)
+  {
+      if(isEmpty() || filteredOut(key))
+          return end();
+      return lookfor(fingerStart(hint.currentNode, key), key);
+  }
 
+  // First item with key not less than key.
+  const_iterator lower_bound(const key_type& key) const
+  {
+      return const_iterator(partitionPoint([this, &key](const key_type& other) { return comp(other, key); }));
+  }
 
-      }
-      delete removingNode;
-      size--;
-      if(isEmpty())
-      {
-          root->left=root;
+  iterator lower_bound(const key_type& key)
+  {
+      return static_cast<const TreeMap*>(this)->lower_bound(key);
+  }
 
-      }
+  // First item with key greater than key.
+  const_iterator upper_bound(const key_type& key) const
+  {
+      return const_iterator(partitionPoint([this, &key](const key_type& other) { return !comp(key, other); }));
+  }
+
+  iterator upper_bound(const key_type& key)
+  {
+      return static_cast<const TreeMap*>(this)->upper_bound(key);
+  }
+
+  // Items whose keys start with prefix, as a [first, last) pair, in O(log n) plus the items visited.
+  // Keys of every item in between share the prefix since keys starting with it are contiguous in
+  // lexicographic order, so only string keys ordered by std::less are supported.
+  std::pair<const_iterator, const_iterator> prefix_range(const key_type& prefix) const
+  {
+      static_assert(std::is_same<Compare, std::less<key_type>>::value,
+                    "prefix_range needs string keys in their natural order");
+      Node* last = partitionPoint([&prefix](const key_type& other) {
+          return other.compare(0, prefix.size(), prefix) <= 0;
+      });
+      return std::make_pair(lower_bound(prefix), const_iterator(last));
+  }
 
+  std::pair<iterator, iterator> prefix_range(const key_type& prefix)
+  {
+      auto range = static_cast<const TreeMap*>(this)->prefix_range(prefix);
+      return std::make_pair(iterator(range.first), iterator(range.second));
+  }
 
+  void remove(const key_type& key)
+  {
+      if(isEmpty())
+          throw std::out_of_range("cannot remove, empty list");
+      auto removingNode = find(key).currentNode;
+      if(removingNode==root)
+          throw std::out_of_range("cannot remove, no such element");
+      removeNode(removingNode);
   }
 
   void disconnectNode(Node *disconnected, Node *son)
@@ -241,7 +1372,9 @@ public:
 
   void remove(const const_iterator& it)
   {
-        remove(it.currentNode->data.first);
+      if(it.currentNode == root)
+          throw std::out_of_range("cannot remove, no such element");
+      removeNode(it.currentNode);
   }
 
   size_type getSize() const
@@ -249,6 +1382,98 @@ public:
     return size;
   }
 
+  key_compare key_comp() const
+  {
+    return comp;
+  }
+
+  // Calls fn(item) for every item, from several threads of pool at once. The tree is split into
+  // subtrees that the pool's workers share by stealing, items are not visited in key order.
+  // fn must be safe to call concurrently, the first exception it throws is rethrown here.
+  template <typename Function>
+  void parallel_for_each(Function fn, ThreadPool& pool = ThreadPool::shared())
+  {
+      if(!isEmpty())
+          forEachParallel(root->left, forkLevels(pool), fn, pool);
+  }
+
+  template <typename Function>
+  void parallel_for_each(Function fn, ThreadPool& pool = ThreadPool::shared()) const
+  {
+      auto visit = [&fn](const value_type& item) { fn(item); };
+      const_cast<TreeMap*>(this)->parallel_for_each(visit, pool);
+  }
+
+  // Folds all items with accumulate(partial, item) on disjoint key ranges in parallel and merges
+  // the partial results of neighbouring ranges with combine(left, right). Every range starts
+  // from init, so init has to be the identity of combine, which must be associative. The result
+  // is then the same as of a sequential fold in key order.
+  template <typename T, typename Accumulate, typename Combine>
+  T parallel_reduce(T init, Accumulate accumulate, Combine combine, ThreadPool& pool = ThreadPool::shared()) const
+  {
+      if(isEmpty())
+          return init;
+      return reduceParallel(root->left, forkLevels(pool), init, accumulate, combine, pool);
+  }
+
+  // Walks the whole tree in pre-order along the parent links, so no stack grows with the height.
+  TreeShape shape() const
+  {
+      TreeShape result = TreeShape();
+      if(isEmpty())
+          return result;
+      size_type depth = 0;
+      size_type depthSum = 0;
+      Node* node = root->left;
+      while(node != nullptr)
+      {
+          if(result.depthHistogram.size() == depth)
+              result.depthHistogram.push_back(0);
+          result.depthHistogram[depth]++;
+          depthSum += depth;
+          if(node->left != nullptr || node->right != nullptr)
+          {
+              node = node->left != nullptr ? node->left : node->right;
+              depth++;
+              continue;
+          }
+          result.leaves++;
+          // climb to the nearest ancestor with an unvisited right subtree.
+          while(true)
+          {
+              Node* parent = node->parent;
+              if(parent == root)
+              {
+                  node = nullptr;
+                  break;
+              }
+              if(parent->left == node && parent->right != nullptr)
+              {
+                  node = parent->right;
+                  break;
+              }
+              node = parent;
+              depth--;
+          }
+      }
+      result.height = result.depthHistogram.size();
+      result.maxDepth = result.height - 1;
+      result.averageDepth = static_cast<double>(depthSum) / size;
+      return result;
+  }
+
+#ifdef AISDI_TREEMAP_STATS
+  SearchStats searchStats() const
+  {
+      return stats;
+  }
+
+  void resetSearchStats()
+  {
+      stats = SearchStats();
+  }
+#endif
+
   bool operator==(const TreeMap& other) const
   {
     if(size != other.size)
@@ -304,16 +1529,11 @@ public:
 
   const_iterator lookfor(Node *starting, const key_type& key) const
   {
-      while(starting != nullptr)
-      {
-          if(starting->data.first == key)
-              return const_iterator(starting);
-          if(starting->data.first > key)
-              starting = starting->left;
-          else
-              starting = starting->right;
-
-      }
+      Node *parent;
+      bool left;
+      Node *found = descend(starting, key, parent, left);
+      if(found != nullptr)
+          return const_iterator(found);
       return cend();
 
   }
@@ -321,14 +1541,15 @@ public:
 
 };
 
-template <typename KeyType, typename ValueType>
-class TreeMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Compare, typename Allocator, typename Layout>
+class TreeMap<KeyType, ValueType, Compare, Allocator, Layout>::ConstIterator
 {
 public:
   using reference = typename TreeMap::const_reference;
   using iterator_category = std::bidirectional_iterator_tag;
   using value_type = typename TreeMap::value_type;
   using pointer = const typename TreeMap::value_type*;
+  using difference_type = std::ptrdiff_t;
 
     Node *currentNode;
 
@@ -403,7 +1624,7 @@ public:
   {
       if(currentNode->right == currentNode)
           throw std::out_of_range("Cannot dereference end");
-      return currentNode->data;
+      return currentNode->item();
   }
 
   pointer operator->() const
@@ -422,8 +1643,9 @@ public:
   }
 };
 
-template <typename KeyType, typename ValueType>
-class TreeMap<KeyType, ValueType>::Iterator : public TreeMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Compare, typename Allocator, typename Layout>
+class TreeMap<KeyType, ValueType, Compare, Allocator, Layout>::Iterator
+  : public TreeMap<KeyType, ValueType, Compare, Allocator, Layout>::ConstIterator
 {
 public:
   using reference = typename TreeMap::reference;
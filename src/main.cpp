@@ -70,6 +70,9 @@ namespace
         std::chrono::duration<double> elapsed_seconds = end-start;
         std::cout << "Adding time in TreeMap: " << elapsed_seconds.count() << "s\n";
 
+        const aisdi::TreeShape shape = map.shape();
+        std::cout << "TreeMap height: " << shape.height << ", average depth: " << shape.averageDepth << "\n";
+
         start = std::chrono::system_clock::now();
         for (auto it = keys.begin(); it !=  keys.end(); ++it)
             map[*it] = "ChangedValue";
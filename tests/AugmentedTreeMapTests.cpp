@@ -0,0 +1,166 @@
+#include <AugmentedTreeMap.h>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <map>
+#include <stdexcept>
+
+#include <boost/test/unit_test.hpp>
+
+#include "OrderedMapChecks.h"
+
+namespace
+{
+
+template <typename K>
+using Map = aisdi::AugmentedTreeMap<K, long>;
+
+using checks::TestedKeyTypes;
+using checks::thenMapContainsItems;
+
+template <typename K>
+long sumOfRange(const std::map<K, long>& items, K first, K last)
+{
+  long sum = 0;
+  for (auto it = items.lower_bound(first); it != items.end() && it->first < last; ++it)
+    sum += it->second;
+  return sum;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(AugmentedTreeMapTests)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCreatedWithDefaultConstructor_ThenItIsEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  checks::thenMapIsEmpty(map);
+  BOOST_CHECK_EQUAL(map.aggregate(), 0);
+  BOOST_CHECK_EQUAL(map.aggregate(0, 100), 0);
+  BOOST_CHECK_THROW(--map.end(), std::out_of_range);
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyItems_WhenIterating_ThenKeysAreSorted,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  const auto expected = checks::insertScattered<K, long>(1000, 2000,
+    [&map](const K& key, const long& value) { map.set(key, value); });
+
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK_EQUAL(map.valueOf(expected.begin()->first), expected.begin()->second);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenChangingMap_WhenAggregatingRanges_ThenSumsMatchAScan,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, long> expected;
+  for (int i = 0; i < 3000; ++i)
+  {
+    const K key = checks::scatteredKey<K>(i, 500);
+    if (i % 3 == 2 && expected.count(key) != 0)
+    {
+      map.remove(key);
+      expected.erase(key);
+    }
+    else
+    {
+      map.set(key, i);
+      expected[key] = i;
+    }
+    if (i % 50 == 0)
+    {
+      for (K first = 0; first < 520; first += 37)
+        for (K last = first; last < 540; last += 61)
+          BOOST_REQUIRE_EQUAL(map.aggregate(first, last), sumOfRange(expected, first, last));
+      BOOST_REQUIRE_EQUAL(map.aggregate(), sumOfRange<K>(expected, 0, 1000));
+    }
+  }
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMinAndMaxMonoids_WhenAggregatingRange_ThenExtremesAreReturned)
+{
+  aisdi::AugmentedTreeMap<int, int, aisdi::MinMonoid<int>> minimum;
+  aisdi::AugmentedTreeMap<int, int, aisdi::MaxMonoid<int>> maximum;
+  for (int key = 0; key < 100; ++key)
+  {
+    minimum.set(key, (key * 37) % 101);
+    maximum.set(key, (key * 37) % 101);
+  }
+
+  BOOST_CHECK_EQUAL(minimum.aggregate(10, 20), 3);
+  BOOST_CHECK_EQUAL(maximum.aggregate(10, 20), 97);
+  BOOST_CHECK_EQUAL(minimum.aggregate(20, 10), std::numeric_limits<int>::max());
+  minimum.remove(11);
+  BOOST_CHECK_EQUAL(minimum.aggregate(10, 20), 13);
+}
+
+BOOST_AUTO_TEST_CASE(GivenCountMonoid_WhenAggregatingRange_ThenItemsAreCountedWhateverTheirValues)
+{
+  aisdi::AugmentedTreeMap<int, std::string, aisdi::CountMonoid> map;
+  for (int key = 0; key < 100; key += 2)
+    map.set(key, "value");
+
+  BOOST_CHECK_EQUAL(map.aggregate(), 50u);
+  BOOST_CHECK_EQUAL(map.aggregate(10, 20), 5u);
+  map.set(10, "other");
+  map.remove(12);
+  BOOST_CHECK_EQUAL(map.aggregate(10, 20), 4u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenNonCommutativeMonoid_WhenAggregating_ThenValuesAreCombinedInKeyOrder)
+{
+  aisdi::AugmentedTreeMap<int, std::string> map;
+  std::string expected;
+  for (int i = 0; i < 26; ++i)
+    map.set((i * 7) % 26, std::string(1, static_cast<char>('a' + (i * 7) % 26)));
+
+  BOOST_CHECK_EQUAL(map.aggregate(), "abcdefghijklmnopqrstuvwxyz");
+  BOOST_CHECK_EQUAL(map.aggregate(3, 9), "defghi");
+  map.set(5, "F");
+  BOOST_CHECK_EQUAL(map.aggregate(3, 9), "deFghi");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenCopyingAndMoving_ThenAggregatesFollow,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, 10 }, { 2, 20 }, { 3, 30 } };
+  Map<K> copy{map};
+  copy.set(4, 40);
+
+  BOOST_CHECK_EQUAL(map.aggregate(), 60);
+  BOOST_CHECK_EQUAL(copy.aggregate(), 100);
+  BOOST_CHECK(map != copy);
+
+  Map<K> moved{std::move(copy)};
+  BOOST_CHECK(copy.isEmpty());
+  BOOST_CHECK_EQUAL(moved.aggregate(2, 4), 50);
+  BOOST_CHECK_THROW(moved.remove(5), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSortedAndRemovedKeys_WhenInspectingTree_ThenItIsAShallowTreap,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 4096; ++i)
+    map.set(i, i);
+  for (int i = 0; i < 4096; i += 3)
+    map.remove(i);
+
+  const checks::InspectedTreap<Map<K>> treap{std::move(map)};
+
+  BOOST_CHECK_LE(treap.checkedHeight(), 3 * checks::optimalHeight(treap.getSize()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,100 @@
+#include <BloomFilter.h>
+
+#include <cstdint>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+namespace
+{
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(BloomFilterTests)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNewFilter_WhenCreated_ThenItIsDisabled,
+                              K,
+                              TestedKeyTypes)
+{
+  aisdi::BloomFilter<K> filter;
+
+  BOOST_CHECK(!filter.isEnabled());
+  BOOST_CHECK_EQUAL(filter.getCapacity(), 0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenInsertedKeys_WhenTestingThem_ThenNoneIsMissed,
+                              K,
+                              TestedKeyTypes)
+{
+  aisdi::BloomFilter<K> filter;
+  filter.reset(10000);
+  for (int i = 0; i < 10000; ++i)
+    filter.insert(static_cast<K>(i * 7919));
+
+  BOOST_CHECK(filter.isEnabled());
+  BOOST_CHECK_GE(filter.getCapacity(), 10000);
+  for (int i = 0; i < 10000; ++i)
+    BOOST_REQUIRE(filter.mayContain(static_cast<K>(i * 7919)));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenFullFilter_WhenTestingOtherKeys_ThenFewGetThrough,
+                              K,
+                              TestedKeyTypes)
+{
+  aisdi::BloomFilter<K> filter;
+  filter.reset(10000);
+  for (int i = 0; i < 10000; ++i)
+    filter.insert(static_cast<K>(2 * i));
+
+  int falsePositives = 0;
+  for (int i = 0; i < 100000; ++i)
+    if (filter.mayContain(static_cast<K>(2 * i + 1)))
+      falsePositives++;
+
+  BOOST_CHECK_LT(falsePositives, 2000);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenFilledFilter_WhenCopying_ThenCopyHoldsTheSameKeys,
+                              K,
+                              TestedKeyTypes)
+{
+  aisdi::BloomFilter<K> filter;
+  filter.reset(1000);
+  for (int i = 0; i < 1000; ++i)
+    filter.insert(static_cast<K>(i));
+
+  const aisdi::BloomFilter<K> copy{filter};
+  aisdi::BloomFilter<K> assigned;
+  assigned = copy;
+  filter.release();
+
+  for (int i = 0; i < 1000; ++i)
+  {
+    BOOST_REQUIRE(copy.mayContain(static_cast<K>(i)));
+    BOOST_REQUIRE(assigned.mayContain(static_cast<K>(i)));
+  }
+  BOOST_CHECK_EQUAL(copy.getCapacity(), assigned.getCapacity());
+}
+
+BOOST_AUTO_TEST_CASE(GivenRemovalsAndGrowth_WhenAskingForRebuild_ThenItIsNeededOnceTheyOutweighKeys)
+{
+  aisdi::BloomFilter<std::string> filter;
+  filter.reset(100);
+  const std::size_t capacity = filter.getCapacity();
+
+  BOOST_CHECK(!filter.needsRebuild(capacity));
+  BOOST_CHECK(filter.needsRebuild(capacity + 1));
+  for (int i = 0; i < 10; ++i)
+    filter.noteRemoval();
+  BOOST_CHECK(!filter.needsRebuild(10));
+  BOOST_CHECK(filter.needsRebuild(9));
+
+  filter.release();
+  BOOST_CHECK(!filter.isEnabled());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
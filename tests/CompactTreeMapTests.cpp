@@ -0,0 +1,164 @@
+#include <CompactTreeMap.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <map>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include <boost/test/unit_test.hpp>
+
+#include "OrderedMapChecks.h"
+
+namespace
+{
+
+template <typename K>
+using Map = aisdi::CompactTreeMap<K, std::string>;
+
+using checks::TestedKeyTypes;
+using checks::thenMapContainsItems;
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(CompactTreeMapTests)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCreatedWithDefaultConstructor_ThenItIsEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  checks::thenMapIsEmpty(map);
+  BOOST_CHECK(map.find(1) == map.end());
+  BOOST_CHECK_THROW(--map.end(), std::out_of_range);
+  BOOST_CHECK_THROW(*map.end(), std::out_of_range);
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyItems_WhenIterating_ThenKeysAreSorted,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  const auto expected = checks::insertScattered<K, std::string>(2000, 5000,
+    [&map](const K& key, const std::string& value) { map[key] = value; });
+
+  thenMapContainsItems(map, expected);
+  for (const auto& item : expected)
+    BOOST_CHECK_EQUAL(map.valueOf(item.first), item.second);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenAssigningThroughIt_ThenValueIsChanged,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+
+  map.find(42)->second = "Carol";
+  (*map.begin()).second = "Dave";
+
+  thenMapContainsItems(map, { { 27, "Dave" }, { 42, "Carol" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenRemovingItems_ThenOtherItemsRemain,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 1000; ++i)
+  {
+    const K key = checks::scatteredKey<K>(i, 1000);
+    map[key] = std::to_string(i);
+    expected[key] = std::to_string(i);
+  }
+
+  for (int i = 0; i < 1000; i += 3)
+  {
+    map.remove((i * 31) % 1000);
+    expected.erase((i * 31) % 1000);
+  }
+  map.remove(map.begin());
+  expected.erase(expected.begin());
+
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK_THROW(map.remove(0), std::out_of_range);
+  BOOST_CHECK_THROW(map.remove(map.end()), std::out_of_range);
+
+  for (const auto& item : expected)
+    map.remove(item.first);
+  BOOST_CHECK(map.isEmpty());
+  map[5] = "again";
+  thenMapContainsItems(map, { { 5, "again" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenCopyingAndMoving_ThenMapsAreIndependent,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
+  Map<K> copy{map};
+  copy[1410] = "Grunwald";
+
+  BOOST_CHECK(map != copy);
+  Map<K> moved{std::move(copy)};
+  BOOST_CHECK(copy.isEmpty());
+  map = moved;
+  BOOST_CHECK(map == moved);
+  thenMapContainsItems(map, { { 753, "Rome" }, { 1410, "Grunwald" }, { 1789, "Paris" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMovedFromMap_WhenReusingIt_ThenItBehavesLikeNewMap,
+                              K,
+                              TestedKeyTypes)
+{
+  static_assert(std::is_nothrow_move_constructible<Map<K>>::value, "moving should not throw");
+  static_assert(std::is_nothrow_move_assignable<Map<K>>::value, "moving should not throw");
+  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
+  Map<K> moved{std::move(map)};
+
+  BOOST_CHECK_EQUAL(map.getSize(), 0);
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK_THROW(map.valueOf(753), std::out_of_range);
+  BOOST_CHECK(map.find(753) == map.end());
+  map[1410] = "Grunwald";
+  moved = std::move(map);
+  map[966] = "Gniezno";
+
+  thenMapContainsItems(map, { { 966, "Gniezno" } });
+  thenMapContainsItems(moved, { { 1410, "Grunwald" } });
+}
+
+BOOST_AUTO_TEST_CASE(GivenReversedComparator_WhenIterating_ThenKeysAreInDescendingOrder)
+{
+  aisdi::CompactTreeMap<std::string, int, std::greater<std::string>> map;
+  map["apple"] = 1;
+  map["pear"] = 2;
+  map["peach"] = 3;
+
+  auto it = map.begin();
+  BOOST_CHECK_EQUAL((it++)->first, "pear");
+  BOOST_CHECK_EQUAL((it++)->first, "peach");
+  BOOST_CHECK_EQUAL((it++)->first, "apple");
+  BOOST_CHECK(it == map.end());
+}
+
+BOOST_AUTO_TEST_CASE(GivenSortedAndRemovedKeys_WhenSearching_ThenRedBlackHeightBoundHolds)
+{
+  aisdi::CompactTreeMap<checks::CountedKey, int> map;
+  const int count = 4095;
+  for (int i = 0; i < count; ++i)
+    map[i] = i;
+  for (int i = 0; i < count; i += 2)
+    map.remove(i);
+
+  // a red-black tree is at most 2 log(n + 1) high, every level takes at most two comparisons.
+  const std::size_t bound = 2 * 2 * checks::optimalHeight(map.getSize());
+  for (int i = 1; i < count; i += 2)
+    BOOST_REQUIRE_LE(checks::comparisonsToFind(map, i), bound);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
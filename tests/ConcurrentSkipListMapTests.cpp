@@ -0,0 +1,271 @@
+#include <ConcurrentSkipListMap.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "OrderedMapChecks.h"
+
+namespace
+{
+
+template <typename K>
+using Map = aisdi::ConcurrentSkipListMap<K, std::string>;
+
+using checks::TestedKeyTypes;
+using checks::thenItemsAreIteratedInOrder;
+
+const int THREADS = 8;
+
+template <typename Function>
+void runInThreads(Function fn)
+{
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS; ++t)
+    threads.emplace_back(fn, t);
+  for (auto& thread : threads)
+    thread.join();
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ConcurrentSkipListMapTests)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCreatedWithDefaultConstructor_ThenItIsEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  checks::thenMapIsEmpty(map);
+  BOOST_CHECK_THROW(*map.end(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyItems_WhenIterating_ThenKeysAreSorted,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  const auto expected = checks::insertScattered<K, std::string>(500, 1000,
+    [&map](const K& key, const std::string& value) { BOOST_CHECK(map.insert(key, value)); });
+
+  thenItemsAreIteratedInOrder(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenExistingKey_WhenInserting_ThenValueIsKept,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" } };
+
+  BOOST_CHECK(!map.insert(42, "Bob"));
+  BOOST_CHECK_EQUAL(map.valueOf(42), "Alice");
+  BOOST_CHECK_EQUAL(map.getSize(), 1);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenSearchingForKey_ThenItemIsReturned,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 99, "Carol" } };
+
+  BOOST_CHECK_EQUAL(map.find(27)->second, "Bob");
+  BOOST_CHECK(map.find(28) == map.end());
+  BOOST_CHECK(map.contains(99));
+  BOOST_CHECK(!map.contains(100));
+  BOOST_CHECK_THROW(map.valueOf(100), std::out_of_range);
+  BOOST_CHECK_EQUAL(map.lowerBound(28)->first, 42);
+  BOOST_CHECK(map.lowerBound(100) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenScanningRange_ThenHalfOpenRangeIsVisitedInOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 100; ++i)
+    map.insert(2 * i, std::to_string(i));
+
+  std::vector<K> visited;
+  map.forEachInRange(11, 21, [&visited](const std::pair<const K, std::string>& item) {
+    visited.push_back(item.first);
+  });
+
+  BOOST_CHECK((visited == std::vector<K>{ 12, 14, 16, 18, 20 }));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenRemovingItems_ThenOtherItemsRemain,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 300; ++i)
+  {
+    map.insert(i, "x");
+    expected[i] = "x";
+  }
+
+  for (int i = 0; i < 300; i += 3)
+  {
+    map.remove(i);
+    expected.erase(i);
+  }
+
+  thenItemsAreIteratedInOrder(map, expected);
+  BOOST_CHECK_THROW(map.remove(0), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMoreLiveIteratorsThanEpochSlots_WhenRemovingTheirItems_ThenTheyStayReadable,
+                              K,
+                              TestedKeyTypes)
+{
+  const int count = 3 * static_cast<int>(aisdi::detail::EpochDomain::SLOTS);
+  Map<K> map;
+  for (int i = 0; i < count; ++i)
+    map.insert(i, std::to_string(i));
+
+  std::vector<typename Map<K>::const_iterator> iterators;
+  for (int i = 0; i < count; ++i)
+    iterators.push_back(map.find(i));
+  for (int i = 0; i < count; i += 2)
+    map.remove(i);
+
+  for (int i = 0; i < count; ++i)
+  {
+    auto& it = iterators[i];
+    BOOST_REQUIRE(it != map.end());
+    BOOST_CHECK_EQUAL(it->second, std::to_string(i));
+    ++it;
+    const int next = i % 2 == 0 ? i + 1 : i + 2;
+    if (next < count)
+      BOOST_CHECK_EQUAL(it->first, static_cast<K>(next));
+    else
+      BOOST_CHECK(it == map.end());
+  }
+  BOOST_CHECK_EQUAL(map.getSize(), static_cast<std::size_t>(count / 2));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenCreatingCopy_ThenAllItemsAreCopied,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
+  const Map<K> other{map};
+
+  map.insert(1410, "Grunwald");
+
+  thenItemsAreIteratedInOrder(other, { { 753, "Rome" }, { 1789, "Paris" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyThreads_WhenInsertingDisjointKeys_ThenAllItemsArePresent,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  const int perThread = 2000;
+
+  runInThreads([&map](int t) {
+    for (int i = 0; i < perThread; ++i)
+      map.insert(i * THREADS + t, std::to_string(t));
+  });
+
+  BOOST_CHECK_EQUAL(map.getSize(), perThread * THREADS);
+  K expectedKey = 0;
+  for (auto it = map.begin(); it != map.end(); ++it, ++expectedKey)
+  {
+    BOOST_REQUIRE_EQUAL(it->first, expectedKey);
+    BOOST_REQUIRE_EQUAL(it->second, std::to_string(expectedKey % THREADS));
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyThreads_WhenInsertingSameKeys_ThenEachKeyIsInsertedOnce,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::atomic<int> successes(0);
+
+  runInThreads([&map, &successes](int) {
+    for (int i = 0; i < 1000; ++i)
+      if (map.insert(i, "x"))
+        successes++;
+  });
+
+  BOOST_CHECK_EQUAL(successes.load(), 1000);
+  BOOST_CHECK_EQUAL(map.getSize(), 1000);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenConcurrentWritersAndReaders_WhenMixingOperations_ThenMapStaysSorted,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::atomic<bool> unordered(false);
+
+  runInThreads([&map, &unordered](int t) {
+    if (t % 2 == 0)
+    {
+      for (int round = 0; round < 20; ++round)
+      {
+        bool first = true;
+        K previous = 0;
+        for (auto it = map.begin(); it != map.end(); ++it)
+        {
+          if (!first && !(previous < it->first))
+            unordered = true;
+          previous = it->first;
+          first = false;
+        }
+      }
+      return;
+    }
+    for (int i = 0; i < 3000; ++i)
+    {
+      const K key = (i * 7919 + t) % 512;
+      if (!map.insert(key, "x"))
+      {
+        try
+        {
+          map.remove(key);
+        }
+        catch (const std::out_of_range&)
+        {
+        }
+      }
+    }
+  });
+
+  BOOST_CHECK(!unordered.load());
+  std::size_t count = 0;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    count++;
+  BOOST_CHECK_EQUAL(map.getSize(), count);
+}
+
+BOOST_AUTO_TEST_CASE(GivenSortedKeys_WhenSearching_ThenLevelsKeepSearchesLogarithmic)
+{
+  aisdi::ConcurrentSkipListMap<checks::CountedKey, int> map;
+  const int count = 4095;
+  for (int i = 0; i < count; ++i)
+    map.insert(i, i);
+
+  // with every level holding about half of the nodes below it, a search makes O(log n) steps.
+  const std::size_t optimal = checks::optimalHeight(count);
+  std::size_t total = 0;
+  for (int i = 0; i < count; ++i)
+  {
+    const std::size_t comparisons = checks::comparisonsToFind(map, i);
+    BOOST_REQUIRE_LE(comparisons, 6 * optimal);
+    total += comparisons;
+  }
+  BOOST_CHECK_LE(total, count * 3 * optimal);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,115 @@
+#include <FrozenTreeMap.h>
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "OrderedMapChecks.h"
+
+namespace
+{
+
+template <typename K>
+using Map = aisdi::FrozenTreeMap<K, std::string>;
+
+using checks::TestedKeyTypes;
+using checks::thenMapContainsItems;
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(FrozenTreeMapTests)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCreatedWithDefaultConstructor_ThenItIsEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  checks::thenMapIsEmpty(map);
+  BOOST_CHECK(map.find(1) == map.end());
+  BOOST_CHECK_THROW(--map.end(), std::out_of_range);
+  BOOST_CHECK_THROW(*map.end(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTreeMap_WhenFreezing_ThenAllItemsAreFoundAndIteratedInOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  aisdi::TreeMap<K, std::string> tree;
+  const auto expected = checks::insertScattered<K, std::string>(1000, 2000,
+    [&tree](const K& key, const std::string& value) { tree[key] = value; });
+
+  const Map<K> map{tree};
+  tree[5000] = "later";
+
+  thenMapContainsItems(map, expected);
+  for (const auto& item : expected)
+    BOOST_CHECK_EQUAL(map.valueOf(item.first), item.second);
+  BOOST_CHECK(map.find(5000) == map.end());
+  BOOST_CHECK_THROW(map.valueOf(5000), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEverySize_WhenSearchingLowerBound_ThenResultMatchesSortedOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  for (int size = 0; size < 70; ++size)
+  {
+    std::vector<std::pair<K, std::string>> items;
+    for (int i = 0; i < size; ++i)
+      items.emplace_back(2 * i + 1, std::to_string(i));
+    const auto map = Map<K>::fromSorted(items.begin(), items.end());
+
+    for (int key = 0; key <= 2 * size + 1; ++key)
+    {
+      auto it = map.lower_bound(key);
+      if (key >= 2 * size)
+      {
+        BOOST_CHECK(it == map.end());
+        continue;
+      }
+      BOOST_REQUIRE(it != map.end());
+      BOOST_CHECK_EQUAL(it->first, key % 2 == 0 ? key + 1 : key);
+      BOOST_CHECK_EQUAL(map.find(key) != map.end(), key % 2 == 1);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenBeginIterator_WhenDecrementing_ThenOperationThrows,
+                              K,
+                              TestedKeyTypes)
+{
+  std::vector<std::pair<K, std::string>> items = { { 27, "Bob" }, { 42, "Alice" }, { 99, "Carol" } };
+  const auto map = Map<K>::fromSorted(items.begin(), items.end());
+
+  auto it = map.end();
+  --it;
+  BOOST_CHECK_EQUAL(it->second, "Carol");
+  BOOST_CHECK_THROW(--map.begin(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenUnsortedRange_WhenBuildingFrozenMap_ThenExceptionIsThrown,
+                              K,
+                              TestedKeyTypes)
+{
+  std::vector<std::pair<K, std::string>> items = { { 42, "Alice" }, { 27, "Bob" } };
+
+  BOOST_CHECK_THROW(Map<K>::fromSorted(items.begin(), items.end()), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(GivenStringKeys_WhenFreezing_ThenKeysAreFound)
+{
+  aisdi::TreeMap<std::string, int> tree = { { "pear", 1 }, { "apple", 2 }, { "peach", 3 }, { "plum", 4 } };
+  const aisdi::FrozenTreeMap<std::string, int> map{tree};
+
+  BOOST_CHECK_EQUAL(map.valueOf("peach"), 3);
+  BOOST_CHECK_EQUAL(map.lower_bound("pea")->first, "peach");
+  BOOST_CHECK_EQUAL(map.begin()->first, "apple");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,8 +2,10 @@
   #include <HashMap.h>
 
 #include <cstdint>
+#include <limits>
 #include <string>
 #include <map>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -788,6 +790,129 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMapsWithDifferentKeys_WhenComparingThem_Th
   BOOST_CHECK(map != other);
 }
 
+template <typename K>
+std::size_t countItems(const Map<K>& map)
+{
+  std::size_t count = 0;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    count++;
+  return count;
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenKeysSharingBucket_WhenAddingAndRemovingThem_ThenOthersCanStillBeFound,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  // keys this far apart land in one bucket once the map hashes them.
+  for (int i = 0; i < 10; ++i)
+  {
+    map[i * 16384] = std::to_string(i);
+    map[i * 16384 + 1] = std::to_string(i);
+    expected[i * 16384] = std::to_string(i);
+    expected[i * 16384 + 1] = std::to_string(i);
+  }
+  map.remove(3 * 16384);
+  expected.erase(3 * 16384);
+  map.remove(0);
+  expected.erase(0);
+
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK_EQUAL(countItems(map), 18);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenKeysTurningSparseAndDenseAgain_WhenChangingMap_ThenAllItemsAreFound,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 20000; ++i)
+  {
+    const int key = (i * 7919) % 20000;
+    map[key] = std::to_string(i);
+    expected[key] = std::to_string(i);
+  }
+  thenMapContainsItems(map, expected);
+
+  for (int key = 0; key < 20000; ++key)
+    if (key % 100 != 0)
+    {
+      map.remove(key);
+      expected.erase(key);
+    }
+  map[1000000] = "far";
+  expected[1000000] = "far";
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK(map.find(1) == map.end());
+
+  for (int key = 0; key < 20000; ++key)
+  {
+    map[key] = "again";
+    expected[key] = "again";
+  }
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK_EQUAL(countItems(map), 20001);
+}
+
+BOOST_AUTO_TEST_CASE(GivenNegativeAndExtremeKeys_WhenAddingThem_ThenAllCanBeFound)
+{
+  const std::vector<std::int32_t> keys = { -1, 0, 1, -5000, 5000,
+                                           std::numeric_limits<std::int32_t>::min(),
+                                           std::numeric_limits<std::int32_t>::max() };
+  aisdi::HashMap<std::int32_t, int> map;
+  for (std::size_t i = 0; i < keys.size(); ++i)
+    map[keys[i]] = static_cast<int>(i);
+
+  BOOST_CHECK_EQUAL(map.getSize(), keys.size());
+  for (std::size_t i = 0; i < keys.size(); ++i)
+    BOOST_CHECK_EQUAL(map.valueOf(keys[i]), static_cast<int>(i));
+  map.remove(std::numeric_limits<std::int32_t>::min());
+  BOOST_CHECK(map.find(std::numeric_limits<std::int32_t>::min()) == map.end());
+  BOOST_CHECK(map.find(2) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenBloomFilter_WhenChangingMap_ThenLookupsMatchReference,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  map.useBloomFilter(true);
+  std::map<K, std::string> expected;
+  // sparse keys, so that the map hashes them and the filter is in use.
+  for (int i = 0; i < 3000; ++i)
+  {
+    const int key = ((i * 7919) % 1000) * 100003;
+    if (i % 3 == 2 && expected.erase(key) != 0)
+      map.remove(key);
+    else
+    {
+      map[key] = std::to_string(i);
+      expected[key] = std::to_string(i);
+    }
+  }
+
+  BOOST_CHECK(map.usesBloomFilter());
+  thenMapContainsItems(map, expected);
+  for (int key = 0; key < 1000; ++key)
+    BOOST_CHECK_EQUAL(map.find(key * 100003) != map.end(), expected.count(key * 100003) == 1);
+
+  Map<K> copy{map};
+  BOOST_CHECK(copy.usesBloomFilter());
+  thenMapContainsItems(copy, expected);
+  map.useBloomFilter(false);
+  BOOST_CHECK(!map.usesBloomFilter());
+  thenMapContainsItems(map, expected);
+
+  Map<K> assigned;
+  assigned = copy;
+  BOOST_CHECK(assigned.usesBloomFilter());
+  assigned = map;
+  BOOST_CHECK(!assigned.usesBloomFilter());
+  thenMapContainsItems(assigned, expected);
+}
+
 // ConstIterator is tested via Iterator methods.
 // If Iterator methods are to be changed, then new ConstIterator tests are required.
 
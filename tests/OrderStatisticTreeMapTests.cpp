@@ -0,0 +1,235 @@
+#include <OrderStatisticTreeMap.h>
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+#include <boost/test/unit_test.hpp>
+
+#include "OrderedMapChecks.h"
+
+namespace
+{
+
+template <typename K>
+using Map = aisdi::OrderStatisticTreeMap<K, std::string>;
+
+using checks::TestedKeyTypes;
+using checks::thenMapContainsItems;
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(OrderStatisticTreeMapTests)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCreatedWithDefaultConstructor_ThenItIsEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  checks::thenMapIsEmpty(map);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyItems_WhenIterating_ThenKeysAreSorted,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  const auto expected = checks::insertScattered<K, std::string>(500, 1000,
+    [&map](const K& key, const std::string& value) { map[key] = value; });
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEndIterator_WhenDecrementing_ThenIteratorPointsToLastItem,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+
+  auto it = map.end();
+  --it;
+
+  BOOST_CHECK_EQUAL(it->first, 42);
+  --it;
+  BOOST_CHECK_EQUAL(it->first, 27);
+  BOOST_CHECK_THROW(--it, std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenAskingForRank_ThenSmallerKeysAreCounted,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 100; ++i)
+    map[2 * i] = "even";
+
+  BOOST_CHECK_EQUAL(map.rank(0), 0);
+  BOOST_CHECK_EQUAL(map.rank(1), 1);
+  BOOST_CHECK_EQUAL(map.rank(50), 25);
+  BOOST_CHECK_EQUAL(map.rank(1000), 100);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenSelecting_ThenKthSmallestItemIsReturned,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 99; i >= 0; --i)
+    map[3 * i] = std::to_string(i);
+
+  for (std::size_t k = 0; k < 100; ++k)
+  {
+    BOOST_CHECK_EQUAL(map.select(k)->first, 3 * k);
+    BOOST_CHECK_EQUAL(map.rank(map.select(k)->first), k);
+  }
+  BOOST_CHECK_THROW(map.select(100), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenCountingRange_ThenHalfOpenRangeIsCounted,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 100; ++i)
+    map[i] = "x";
+
+  BOOST_CHECK_EQUAL(map.count(10, 20), 10);
+  BOOST_CHECK_EQUAL(map.count(95, 200), 5);
+  BOOST_CHECK_EQUAL(map.count(20, 10), 0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenRemovingItems_ThenRanksAreUpdated,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 200; ++i)
+  {
+    map[i] = "x";
+    expected[i] = "x";
+  }
+
+  for (int i = 0; i < 200; i += 3)
+  {
+    map.remove(i);
+    expected.erase(i);
+  }
+
+  thenMapContainsItems(map, expected);
+  for (std::size_t k = 0; k < expected.size(); ++k)
+    BOOST_CHECK_EQUAL(map.select(k)->first, std::next(expected.begin(), k)->first);
+  BOOST_CHECK_EQUAL(map.count(0, 30), 20);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenRemovingValueByWrongKey_ThenExceptionIsThrown,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+
+  BOOST_CHECK_THROW(map.remove(43), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenCreatingCopy_ThenAllItemsAreCopied,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
+  const Map<K> other{map};
+
+  map[1410] = "Grunwald";
+
+  thenMapContainsItems(other, { { 753, "Rome" }, { 1789, "Paris" } });
+  BOOST_CHECK_EQUAL(other.rank(1000), 1);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenMoveAssigning_ThenAllElementsAreMoved,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
+  Map<K> other = { { 42, "Alice" }, { 27, "Bob" } };
+
+  other = std::move(map);
+
+  thenMapContainsItems(other, { { 753, "Rome" }, { 1789, "Paris" } });
+  BOOST_CHECK(map.isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenSplitting_ThenKeysAreDividedAtBoundary,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> lower;
+  std::map<K, std::string> upper;
+  for (int i = 0; i < 300; ++i)
+  {
+    const K key = checks::scatteredKey<K>(i, 300);
+    map[key] = std::to_string(i);
+    (key < 120 ? lower : upper)[key] = std::to_string(i);
+  }
+
+  auto parts = map.split(120);
+
+  BOOST_CHECK(map.isEmpty());
+  thenMapContainsItems(parts.first, lower);
+  thenMapContainsItems(parts.second, upper);
+  BOOST_CHECK_EQUAL(parts.second.rank(150), 30);
+  BOOST_CHECK_EQUAL(parts.first.select(119)->first, 119);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSplitMap_WhenJoiningParts_ThenOriginalMapIsRestored,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 200; ++i)
+  {
+    map[i] = std::to_string(i);
+    expected[i] = std::to_string(i);
+  }
+
+  auto parts = map.split(77);
+  parts.second[500] = "500";
+  expected[500] = "500";
+  auto joined = Map<K>::join(std::move(parts.first), std::move(parts.second));
+
+  thenMapContainsItems(joined, expected);
+  BOOST_CHECK(parts.first.isEmpty());
+  BOOST_CHECK(parts.second.isEmpty());
+  BOOST_CHECK_EQUAL(joined.rank(77), 77);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenOverlappingMaps_WhenJoining_ThenExceptionIsThrown,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> less = { { 1, "a" }, { 5, "e" } };
+  Map<K> greater = { { 3, "c" }, { 7, "g" } };
+
+  BOOST_CHECK_THROW(Map<K>::join(std::move(less), std::move(greater)), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSplitAndJoinedMaps_WhenInspectingTrees_ThenTheyAreShallowTreaps,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 4096; ++i)
+    map[i] = std::to_string(i);
+
+  auto parts = map.split(1000);
+  const checks::InspectedTreap<Map<K>> less{std::move(parts.first)};
+  BOOST_CHECK_LE(less.checkedHeight(), 3 * checks::optimalHeight(1000));
+
+  const checks::InspectedTreap<Map<K>> joined{Map<K>::join(std::move(parts.second), Map<K>{ { 5000, "5000" } })};
+  BOOST_CHECK_LE(joined.checkedHeight(), 3 * checks::optimalHeight(3097));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
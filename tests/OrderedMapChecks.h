@@ -0,0 +1,177 @@
+#ifndef AISDI_MAPS_TESTS_ORDEREDMAPCHECKS_H
+#define AISDI_MAPS_TESTS_ORDEREDMAPCHECKS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+// Checks shared by the suites of the ordered maps, each suite adds the ones specific to its structure.
+namespace checks
+{
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+// i-th key scattered over [0, range), the first range of them are distinct as 7919 is a prime.
+template <typename K>
+K scatteredKey(int i, int range)
+{
+  return static_cast<K>((static_cast<long long>(i) * 7919) % range);
+}
+
+template <typename V>
+V valueFor(int i)
+{
+  return static_cast<V>(i);
+}
+
+template <>
+inline std::string valueFor<std::string>(int i)
+{
+  return std::to_string(i);
+}
+
+// Passes count scattered keys to insert(key, value), returns the items a map should hold afterwards.
+template <typename K, typename V, typename Insert>
+std::map<K, V> insertScattered(int count, int range, Insert insert)
+{
+  std::map<K, V> expected;
+  for (int i = 0; i < count; ++i)
+  {
+    const K key = scatteredKey<K>(i, range);
+    insert(key, valueFor<V>(i));
+    expected[key] = valueFor<V>(i);
+  }
+  return expected;
+}
+
+template <typename Map>
+void thenMapIsEmpty(const Map& map)
+{
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK_EQUAL(map.getSize(), 0);
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK_THROW(++map.end(), std::out_of_range);
+}
+
+// For maps with forward iterators only.
+template <typename Map>
+void thenItemsAreIteratedInOrder(const Map& map,
+                                 const std::map<typename Map::key_type, typename Map::mapped_type>& expected)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+
+  auto it = map.begin();
+  for (const auto& item : expected)
+  {
+    BOOST_REQUIRE(it != map.end());
+    BOOST_CHECK_EQUAL(it->first, item.first);
+    BOOST_CHECK_EQUAL(it->second, item.second);
+    ++it;
+  }
+  BOOST_CHECK(it == map.end());
+}
+
+template <typename Map>
+void thenMapContainsItems(const Map& map,
+                          const std::map<typename Map::key_type, typename Map::mapped_type>& expected)
+{
+  thenItemsAreIteratedInOrder(map, expected);
+
+  auto it = map.end();
+  for (auto item = expected.rbegin(); item != expected.rend(); ++item)
+  {
+    --it;
+    BOOST_CHECK_EQUAL((*it).first, item->first);
+  }
+}
+
+// Integer key counting every comparison made on it, which tells how deep searches go
+// without looking into the structure.
+class CountedKey
+{
+public:
+  CountedKey(int value_ = 0) : value(value_)
+  {}
+
+  friend bool operator<(const CountedKey& left, const CountedKey& right)
+  {
+    ++comparisons();
+    return left.value < right.value;
+  }
+
+  static std::size_t& comparisons()
+  {
+    static std::size_t count = 0;
+    return count;
+  }
+
+private:
+  int value;
+};
+
+// Comparisons made by the search for key.
+template <typename Map>
+std::size_t comparisonsToFind(const Map& map, int key)
+{
+  CountedKey::comparisons() = 0;
+  BOOST_REQUIRE(map.find(key) != map.end());
+  return CountedKey::comparisons();
+}
+
+// Levels of a perfectly balanced tree with count nodes.
+inline std::size_t optimalHeight(std::size_t count)
+{
+  std::size_t levels = 0;
+  for (; count > 0; count >>= 1)
+    levels++;
+  return levels;
+}
+
+// Opens up a treap built on AugmentedTreeMap, the map is moved in to be inspected.
+template <typename Map>
+class InspectedTreap : public Map
+{
+public:
+  explicit InspectedTreap(Map&& map) : Map(std::move(map))
+  {}
+
+  // Walks the whole tree checking the links, the key order, the heap order of priorities
+  // and the aggregate of every subtree. Returns the height.
+  std::size_t checkedHeight() const
+  {
+    return check(this->head.left, &this->head);
+  }
+
+private:
+  template <typename Node>
+  std::size_t check(const Node* node, const Node* parent) const
+  {
+    if (node == nullptr)
+      return 0;
+    BOOST_REQUIRE(node->parent == parent);
+    if (parent != &this->head)
+      BOOST_REQUIRE_GE(parent->priority, node->priority);
+    if (node->left != nullptr)
+      BOOST_REQUIRE(node->left->data.first < node->data.first);
+    if (node->right != nullptr)
+      BOOST_REQUIRE(node->data.first < node->right->data.first);
+    const std::size_t left = check(node->left, node);
+    const std::size_t right = check(node->right, node);
+    BOOST_REQUIRE(node->aggregate == this->monoid(this->monoid(this->aggregateOf(node->left),
+                                                               this->measure(node->data.second)),
+                                                  this->aggregateOf(node->right)));
+    return 1 + std::max(left, right);
+  }
+};
+
+} // namespace checks
+
+#endif /* AISDI_MAPS_TESTS_ORDEREDMAPCHECKS_H */
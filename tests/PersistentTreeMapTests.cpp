@@ -0,0 +1,194 @@
+#include <PersistentTreeMap.h>
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "OrderedMapChecks.h"
+
+namespace
+{
+
+template <typename K>
+using Map = aisdi::PersistentTreeMap<K, std::string>;
+
+using checks::TestedKeyTypes;
+using checks::thenMapContainsItems;
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(PersistentTreeMapTests)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCreatedWithDefaultConstructor_ThenItIsEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  checks::thenMapIsEmpty(map);
+  BOOST_CHECK_THROW(--map.end(), std::out_of_range);
+  BOOST_CHECK_THROW(*map.end(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyItems_WhenIteratingBothWays_ThenKeysAreSorted,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  const auto expected = checks::insertScattered<K, std::string>(500, 1000,
+    [&map](const K& key, const std::string& value) { map.set(key, value); });
+
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK_THROW(--map.begin(), std::out_of_range);
+  auto first = map.begin();
+  ++first;
+  --first;
+  BOOST_CHECK_THROW(--first, std::out_of_range);
+  BOOST_CHECK(first == map.begin());
+  BOOST_CHECK_EQUAL((*first).first, expected.begin()->first);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenSearchingForKey_ThenItemIsReturned,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 99, "Carol" } };
+
+  BOOST_CHECK_EQUAL(map.find(27)->second, "Bob");
+  BOOST_CHECK_EQUAL((++map.find(27))->second, "Alice");
+  BOOST_CHECK(map.find(28) == map.end());
+  BOOST_CHECK_EQUAL(map.valueOf(99), "Carol");
+  BOOST_CHECK_THROW(map.valueOf(100), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSnapshot_WhenUpdatingMap_ThenSnapshotIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> before;
+  for (int i = 0; i < 100; ++i)
+  {
+    map.set(i, "old");
+    before[i] = "old";
+  }
+
+  const Map<K> snapshot = map.snapshot();
+  map.set(5, "new");
+  map.set(1000, "added");
+  map.remove(7);
+
+  thenMapContainsItems(snapshot, before);
+  BOOST_CHECK_EQUAL(map.valueOf(5), "new");
+  BOOST_CHECK_EQUAL(map.getSize(), 100);
+  BOOST_CHECK(map.find(7) == map.end());
+  BOOST_CHECK(snapshot != map);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManySnapshots_WhenEachIsUpdated_ThenVersionsStayIndependent,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::vector<Map<K>> versions;
+  for (int i = 0; i < 50; ++i)
+  {
+    versions.push_back(map.snapshot());
+    map.set(i, std::to_string(i));
+  }
+
+  for (std::size_t i = 0; i < versions.size(); ++i)
+  {
+    BOOST_CHECK_EQUAL(versions[i].getSize(), i);
+    if (i > 0)
+      BOOST_CHECK_EQUAL(versions[i].valueOf(i - 1), std::to_string(i - 1));
+    BOOST_CHECK(versions[i].find(i) == versions[i].end());
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenRemovingItems_ThenOtherItemsRemain,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 300; ++i)
+  {
+    const K key = checks::scatteredKey<K>(i, 300);
+    map.set(key, "x");
+    expected[key] = "x";
+  }
+
+  for (int i = 0; i < 300; i += 3)
+  {
+    map.remove(i);
+    expected.erase(i);
+  }
+  map.remove(map.begin());
+  expected.erase(expected.begin());
+
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK_THROW(map.remove(0), std::out_of_range);
+  BOOST_CHECK_THROW(map.remove(map.end()), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenDroppedVersions_WhenLastHolderIsGone_ThenValuesAreReleased,
+                              K,
+                              TestedKeyTypes)
+{
+  auto tracker = std::make_shared<int>(0);
+  {
+    aisdi::PersistentTreeMap<K, std::shared_ptr<int>> map;
+    for (int i = 0; i < 20; ++i)
+      map.set(i, tracker);
+    auto snapshot = map.snapshot();
+    map.remove(3);
+    map.set(4, nullptr);
+
+    BOOST_CHECK_EQUAL(*snapshot.valueOf(3), 0);
+    BOOST_CHECK_GT(tracker.use_count(), 20);
+  }
+  BOOST_CHECK_EQUAL(tracker.use_count(), 1);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenMoving_ThenItemsAreMovedAndSourceIsUsable,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
+  Map<K> other = { { 42, "Alice" } };
+
+  other = std::move(map);
+  Map<K> third{std::move(other)};
+  map.set(1, "One");
+
+  thenMapContainsItems(third, { { 753, "Rome" }, { 1789, "Paris" } });
+  thenMapContainsItems(map, { { 1, "One" } });
+  BOOST_CHECK(other.isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(GivenSortedKeys_WhenSearching_ThenTreapStaysShallow)
+{
+  aisdi::PersistentTreeMap<checks::CountedKey, int> map;
+  const int count = 4095;
+  for (int i = 0; i < count; ++i)
+    map.set(i, i);
+
+  // find() walks down twice, with up to two comparisons on every level.
+  const std::size_t optimal = checks::optimalHeight(count);
+  std::size_t total = 0;
+  for (int i = 0; i < count; ++i)
+  {
+    const std::size_t comparisons = checks::comparisonsToFind(map, i);
+    BOOST_REQUIRE_LE(comparisons, 4 * 3 * optimal);
+    total += comparisons;
+  }
+  BOOST_CHECK_LE(total, count * 4 * 2 * optimal);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,172 @@
+#include <RadixTreeMap.h>
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "OrderedMapChecks.h"
+
+namespace
+{
+
+template <typename K>
+using Map = aisdi::RadixTreeMap<K, std::string>;
+
+using checks::TestedKeyTypes;
+using checks::thenMapContainsItems;
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(RadixTreeMapTests)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCreatedWithDefaultConstructor_ThenItIsEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  checks::thenMapIsEmpty(map);
+  BOOST_CHECK(map.find(1) == map.end());
+  BOOST_CHECK_THROW(--map.end(), std::out_of_range);
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyItems_WhenIterating_ThenKeysAreSorted,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  const auto expected = checks::insertScattered<K, std::string>(2000, 100000,
+    [&map](const K& key, const std::string& value) { map[key] = value; });
+
+  thenMapContainsItems(map, expected);
+  for (const auto& item : expected)
+    BOOST_CHECK_EQUAL(map.find(item.first)->second, item.second);
+}
+
+BOOST_AUTO_TEST_CASE(GivenNegativeKeys_WhenIterating_ThenTheyComeBeforePositiveOnes)
+{
+  Map<std::int32_t> map;
+  std::map<std::int32_t, std::string> expected;
+  for (std::int32_t key : { 5, -1, 0, -300000, 70000, INT32_MIN, INT32_MAX, -2 })
+  {
+    map[key] = std::to_string(key);
+    expected[key] = std::to_string(key);
+  }
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenDenseKeys_WhenInsertingAndRemoving_ThenNodesGrowAndShrink,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 600; ++i)
+  {
+    map[i] = std::to_string(i);
+    expected[i] = std::to_string(i);
+  }
+  thenMapContainsItems(map, expected);
+
+  for (int i = 0; i < 600; ++i)
+  {
+    if (i % 7 == 0 || (i / 256) == 1)
+      continue;
+    map.remove(i);
+    expected.erase(i);
+  }
+  thenMapContainsItems(map, expected);
+
+  for (const auto& item : expected)
+    map.remove(item.first);
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenRemovingMissingKey_ThenExceptionIsThrown,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+
+  BOOST_CHECK_THROW(map.remove(43), std::out_of_range);
+  BOOST_CHECK_THROW(map.remove(map.end()), std::out_of_range);
+  map.remove(map.find(42));
+  thenMapContainsItems(map, { { 27, "Bob" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIteratorFromFind_WhenMovingBothWays_ThenNeighboursAreVisited,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 300; ++i)
+    map[3 * i] = std::to_string(i);
+
+  auto it = map.find(150);
+  BOOST_CHECK_EQUAL((++it)->first, 153);
+  BOOST_CHECK_EQUAL((--it)->first, 150);
+  BOOST_CHECK_EQUAL((--it)->first, 147);
+  BOOST_CHECK_THROW(--map.begin(), std::out_of_range);
+  BOOST_CHECK_EQUAL((--map.end())->first, 897);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenCreatingCopy_ThenBothMapsAreEqualAndIndependent,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" }, { 1410, "Grunwald" } };
+  Map<K> other{map};
+
+  BOOST_CHECK(map == other);
+  other[1] = "one";
+  BOOST_CHECK(map != other);
+
+  Map<K> moved{std::move(other)};
+  BOOST_CHECK(other.isEmpty());
+  thenMapContainsItems(moved, { { 1, "one" }, { 753, "Rome" }, { 1410, "Grunwald" }, { 1789, "Paris" } });
+}
+
+BOOST_AUTO_TEST_CASE(GivenStringKeysThatArePrefixesOfEachOther_WhenIterating_ThenShorterKeysComeFirst)
+{
+  aisdi::RadixTreeMap<std::string, int> map;
+  std::map<std::string, int> expected;
+  const std::vector<std::string> keys = { "a", "", "ab", "abc", "abd", "b", "abcdefghijklmnop", "abcdefghijklmnoq",
+                                          "\xff", "ab\xff", "zz", "abcdefghijk" };
+  for (std::size_t i = 0; i < keys.size(); ++i)
+  {
+    map[keys[i]] = static_cast<int>(i);
+    expected[keys[i]] = static_cast<int>(i);
+  }
+
+  auto it = map.begin();
+  for (const auto& item : expected)
+  {
+    BOOST_REQUIRE(it != map.end());
+    BOOST_CHECK_EQUAL(it->first, item.first);
+    BOOST_CHECK_EQUAL(it->second, item.second);
+    ++it;
+  }
+  BOOST_CHECK(map.find("abcdefghij") == map.end());
+  BOOST_CHECK(map.find("abcd") == map.end());
+
+  for (const auto& key : { "ab", "", "abcdefghijklmnop", "a" })
+  {
+    map.remove(key);
+    expected.erase(key);
+  }
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+  it = map.end();
+  for (auto item = expected.rbegin(); item != expected.rend(); ++item)
+    BOOST_CHECK_EQUAL((--it)->first, item->first);
+  BOOST_CHECK_EQUAL(map.valueOf("abcdefghijklmnoq"), 7);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
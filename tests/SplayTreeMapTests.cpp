@@ -0,0 +1,179 @@
+#include <SplayTreeMap.h>
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include <stdexcept>
+
+#include <boost/test/unit_test.hpp>
+
+#include "OrderedMapChecks.h"
+
+namespace
+{
+
+template <typename K>
+using Map = aisdi::SplayTreeMap<K, std::string>;
+
+using checks::TestedKeyTypes;
+using checks::thenMapContainsItems;
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(SplayTreeMapTests)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCreatedWithDefaultConstructor_ThenItIsEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  checks::thenMapIsEmpty(map);
+  BOOST_CHECK_THROW(--map.end(), std::out_of_range);
+  BOOST_CHECK_THROW(*map.end(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyItems_WhenIteratingBothWays_ThenKeysAreSorted,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  const auto expected = checks::insertScattered<K, std::string>(500, 1000,
+    [&map](const K& key, const std::string& value) { map[key] = value; });
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenBeginIterator_WhenDecrementing_ThenOperationThrows,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+
+  BOOST_CHECK_THROW(--map.begin(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenSearchingForKey_ThenItemIsReturned,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 99, "Carol" } };
+
+  BOOST_CHECK_EQUAL(map.find(27)->second, "Bob");
+  BOOST_CHECK(map.find(28) == map.end());
+  BOOST_CHECK_EQUAL(map.valueOf(99), "Carol");
+  BOOST_CHECK_THROW(map.valueOf(100), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenRemovingItems_ThenOrderIsKept,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 300; ++i)
+  {
+    const K key = checks::scatteredKey<K>(i, 300);
+    map[key] = "x";
+    expected[key] = "x";
+  }
+
+  for (int i = 0; i < 300; i += 2)
+  {
+    const K key = (i * 31) % 300;
+    if (expected.count(key) == 0)
+      continue;
+    map.remove(key);
+    expected.erase(key);
+    thenMapContainsItems(map, expected);
+  }
+
+  BOOST_CHECK_THROW(map.remove(1000), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSingleItemMap_WhenRemovingItemByIterator_ThenMapBecomesEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" } };
+
+  map.remove(map.begin());
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenCreatingCopy_ThenAllItemsAreCopied,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" }, { 1410, "Grunwald" } };
+  const Map<K> other{map};
+
+  map[1920] = "Warsaw";
+
+  thenMapContainsItems(other, { { 753, "Rome" }, { 1789, "Paris" }, { 1410, "Grunwald" } });
+  BOOST_CHECK(other != map);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenMoving_ThenItemsAreMovedAndSourceIsUsable,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
+  Map<K> other = { { 42, "Alice" } };
+
+  other = std::move(map);
+  Map<K> third{std::move(other)};
+  map[1] = "One";
+
+  thenMapContainsItems(third, { { 753, "Rome" }, { 1789, "Paris" } });
+  thenMapContainsItems(map, { { 1, "One" } });
+  BOOST_CHECK(other.isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSequentialKeys_WhenLookingThemUpRepeatedly_ThenValuesAreFound,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 20000; ++i)
+    map[i] = std::to_string(i);
+
+  for (int round = 0; round < 3; ++round)
+    for (int i = 0; i < 20000; i += 7)
+      BOOST_REQUIRE_EQUAL(map.valueOf(i), std::to_string(i));
+  for (int i = 0; i < 1000; ++i)
+    BOOST_REQUIRE_EQUAL(map.find(42)->second, "42");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenConstMap_WhenSearching_ThenItStillFindsItems,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 99, "Carol" } };
+
+  BOOST_CHECK_EQUAL(map.find(99)->second, "Carol");
+  BOOST_CHECK_EQUAL(map.valueOf(27), "Bob");
+  thenMapContainsItems(map, { { 42, "Alice" }, { 27, "Bob" }, { 99, "Carol" } });
+}
+
+BOOST_AUTO_TEST_CASE(GivenChainShapedTree_WhenSearchingRepeatedly_ThenCostIsAmortizedLogarithmic)
+{
+  aisdi::SplayTreeMap<checks::CountedKey, int> map;
+  const int count = 4095;
+  // sorted insertions leave a chain, every new key is splayed to the root.
+  for (int i = 0; i < count; ++i)
+    map[i] = i;
+
+  checks::CountedKey::comparisons() = 0;
+  const int searches = 4 * count;
+  for (int i = 0; i < searches; ++i)
+    BOOST_REQUIRE(map.find(checks::scatteredKey<int>(i, count)) != map.end());
+
+  // at most 3 log n + 1 rotations per search plus the initial potential of n log n, two comparisons a level.
+  const std::size_t optimal = checks::optimalHeight(count);
+  BOOST_CHECK_LE(checks::CountedKey::comparisons(), 2 * ((3 * optimal + 1) * searches + count * optimal));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,139 @@
+#include <ThreadPool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+
+const int THREADS = 4;
+
+// Sum of 0..n - 1 computed by splitting the range in halves down to single numbers.
+long sumInParallel(aisdi::ThreadPool& pool, long first, long last)
+{
+  if (last - first == 1)
+    return first;
+  long middle = first + (last - first) / 2;
+  long left = 0;
+  aisdi::TaskGroup group(pool);
+  group.run([&pool, &left, first, middle]() { left = sumInParallel(pool, first, middle); });
+  long right = sumInParallel(pool, middle, last);
+  group.wait();
+  return left + right;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ThreadPoolTests)
+
+BOOST_AUTO_TEST_CASE(GivenPool_WhenRunningTasksInGroup_ThenAllTasksAreFinishedAfterWait)
+{
+  aisdi::ThreadPool pool(THREADS);
+  std::atomic<int> counter(0);
+
+  aisdi::TaskGroup group(pool);
+  for (int i = 0; i < 1000; ++i)
+    group.run([&counter]() { counter++; });
+  group.wait();
+
+  BOOST_CHECK_EQUAL(pool.getThreadCount(), THREADS);
+  BOOST_CHECK_EQUAL(counter.load(), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(GivenNestedGroups_WhenSplittingRecursively_ThenWorkersDoNotDeadlock)
+{
+  aisdi::ThreadPool pool(THREADS);
+
+  BOOST_CHECK_EQUAL(sumInParallel(pool, 0, 100000), 4999950000L);
+}
+
+BOOST_AUTO_TEST_CASE(GivenSingleThreadPool_WhenNestingGroups_ThenWaitingThreadRunsTasks)
+{
+  aisdi::ThreadPool pool(1);
+
+  BOOST_CHECK_EQUAL(sumInParallel(pool, 0, 1000), 499500L);
+}
+
+BOOST_AUTO_TEST_CASE(GivenThrowingTask_WhenWaiting_ThenExceptionIsRethrown)
+{
+  aisdi::ThreadPool pool(THREADS);
+  std::atomic<int> counter(0);
+
+  aisdi::TaskGroup group(pool);
+  for (int i = 0; i < 100; ++i)
+    group.run([&counter, i]() {
+      counter++;
+      if (i == 50)
+        throw std::runtime_error("task failed");
+    });
+
+  BOOST_CHECK_THROW(group.wait(), std::runtime_error);
+  BOOST_CHECK_EQUAL(counter.load(), 100);
+  group.wait();
+}
+
+BOOST_AUTO_TEST_CASE(GivenUnrelatedQueuedTask_WhenWaitingForGroup_ThenOnlyGroupTasksAreRun)
+{
+  aisdi::ThreadPool pool(1);
+  std::atomic<bool> started(false);
+  std::atomic<bool> released(false);
+  std::atomic<bool> unrelatedRun(false);
+  pool.submit([&started, &released]() {
+    started = true;
+    while (!released)
+      std::this_thread::yield();
+  });
+  while (!started)
+    std::this_thread::yield();
+
+  int groupTasks = 0;
+  {
+    aisdi::TaskGroup group(pool);
+    group.run([&groupTasks]() { groupTasks++; });
+    pool.submit([&unrelatedRun]() { unrelatedRun = true; });
+    group.wait();
+  }
+
+  BOOST_CHECK_EQUAL(groupTasks, 1);
+  BOOST_CHECK(!unrelatedRun.load());
+  released = true;
+  while (!unrelatedRun)
+    std::this_thread::yield();
+}
+
+BOOST_AUTO_TEST_CASE(GivenQueuedTasks_WhenDestroyingPool_ThenTheyAreRunFirst)
+{
+  std::atomic<int> counter(0);
+  {
+    aisdi::ThreadPool pool(2);
+    for (int i = 0; i < 500; ++i)
+      pool.submit([&counter]() { counter++; });
+  }
+
+  BOOST_CHECK_EQUAL(counter.load(), 500);
+}
+
+BOOST_AUTO_TEST_CASE(GivenLargeRange_WhenSortingInParallel_ThenItIsSorted)
+{
+  aisdi::ThreadPool pool(THREADS);
+  for (std::size_t count : { 10, 5000, 100003 })
+  {
+    std::vector<int> numbers;
+    for (std::size_t i = 0; i < count; ++i)
+      numbers.push_back(static_cast<int>((i * 7919) % 10007));
+    std::vector<int> expected = numbers;
+    std::sort(expected.begin(), expected.end());
+
+    aisdi::parallelSort(numbers.begin(), numbers.end(), std::less<int>(), pool);
+
+    BOOST_CHECK(numbers == expected);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,8 +1,13 @@
 #include <TreeMap.h>
 
 #include <cstdint>
+#include <functional>
 #include <string>
+#include <type_traits>
 #include <map>
+#include <memory>
+#include <stdexcept>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -128,6 +133,8 @@ template <typename K>
 using Map = aisdi::TreeMap<K, std::string>;
 
 using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t, OperationCountingObject>;
+// keys with a std::hash, which a Bloom filter needs.
+using HashedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
 using std::begin;
 using std::end;
 
@@ -786,6 +793,825 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMapsWithDifferentKeys_WhenComparingThem_Th
   BOOST_CHECK(map != other);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSortedRange_WhenBuildingFromSorted_ThenAllItemsAreInMap,
+                              K,
+                              TestedKeyTypes)
+{
+  const std::vector<std::pair<K, std::string>> items = { { 27, "Bob" }, { 42, "Alice" }, { 753, "Rome" } };
+
+  const auto map = Map<K>::fromSorted(items.begin(), items.end());
+
+  thenMapContainsItems(map, { { 27, "Bob" }, { 42, "Alice" }, { 753, "Rome" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenUnsortedRange_WhenBuildingFromSorted_ThenExceptionIsThrown,
+                              K,
+                              TestedKeyTypes)
+{
+  const std::vector<std::pair<K, std::string>> items = { { 42, "Alice" }, { 27, "Bob" } };
+
+  BOOST_CHECK_THROW(Map<K>::fromSorted(items.begin(), items.end()), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSequentiallyFilledMap_WhenCreatingCopy_ThenAllItemsAreCopied,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 2000; ++i)
+  {
+    map[i] = std::to_string(i);
+    expected[i] = std::to_string(i);
+  }
+
+  Map<K> other = { { 42, "Alice" } };
+  other = map;
+
+  thenMapContainsItems(Map<K>{map}, expected);
+  thenMapContainsItems(other, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCheckingMoveOperations_ThenTheyDoNotThrow,
+                              K,
+                              TestedKeyTypes)
+{
+  BOOST_CHECK(std::is_nothrow_move_constructible<Map<K>>::value);
+  BOOST_CHECK(std::is_nothrow_move_assignable<Map<K>>::value);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMovedFromMap_WhenAddingItem_ThenItIsUsable,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
+  Map<K> other{std::move(map)};
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  map[1410] = "Grunwald";
+
+  thenMapContainsItems(map, { { 1410, "Grunwald" } });
+  thenMapContainsItems(other, { { 753, "Rome" }, { 1789, "Paris" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenVectorOfMaps_WhenItGrows_ThenMapsKeepTheirItems,
+                              K,
+                              TestedKeyTypes)
+{
+  std::vector<Map<K>> maps;
+
+  for (int i = 0; i < 20; ++i)
+  {
+    maps.emplace_back();
+    maps.back()[i] = std::to_string(i);
+  }
+
+  for (int i = 0; i < 20; ++i)
+    thenMapContainsItems(maps[i], { { i, std::to_string(i) } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenItIsDestroyed_ThenAllItemsAreDestroyed,
+                              K,
+                              TestedKeyTypes)
+{
+  {
+    Map<K> map = { { 753, "Rome" }, { 1789, "Paris" }, { 1410, "Grunwald" } };
+    OperationCountingObject::resetCounters();
+  }
+
+  // the sentinel holds a key as well
+  thenDestroyedObjectsCountWas<K>(4);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenClearing_ThenItBecomesEmptyAndUsable,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 1000; ++i)
+    map[(i * 7919) % 1000] = "x";
+
+  map.clear();
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  map[42] = "Alice";
+  thenMapContainsItems(map, { { 42, "Alice" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapWithStandardAllocator_WhenAddingAndRemovingItems_ThenItWorks,
+                              K,
+                              TestedKeyTypes)
+{
+  using StdMap = aisdi::TreeMap<K, std::string, std::less<K>, std::allocator<std::pair<const K, std::string>>>;
+  StdMap map = { { 753, "Rome" }, { 1789, "Paris" }, { 1410, "Grunwald" } };
+
+  map.remove(1789);
+  StdMap other{map};
+  map.clear();
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK_EQUAL(other.getSize(), 2);
+  BOOST_CHECK_EQUAL(other.valueOf(753), "Rome");
+  BOOST_CHECK_EQUAL(other.valueOf(1410), "Grunwald");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNearlySortedKeys_WhenInsertingWithHint_ThenAllItemsAreInMap,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  auto hint = map.end();
+
+  for (int i = 0; i < 300; ++i)
+  {
+    const int key = i % 2 == 0 ? i + 1 : i - 1;
+    hint = map.insert(hint, key, std::to_string(key));
+    expected[key] = std::to_string(key);
+    BOOST_CHECK_EQUAL(hint->first, key);
+  }
+  hint = map.insert(map.begin(), 150, "ignored");
+
+  BOOST_CHECK_EQUAL(hint->second, "150");
+  thenMapContainsItems(map, expected);
+}
+
+#ifdef AISDI_TREEMAP_STATS
+BOOST_AUTO_TEST_CASE(GivenSortedKeys_WhenInsertingWithHint_ThenEachIsLinkedNextToItAndTreeStaysShallow)
+{
+  const int count = 100000;
+  Map<std::int32_t> ascending;
+  Map<std::int32_t> descending;
+  auto after = ascending.end();
+  auto before = descending.end();
+
+  for (int i = 0; i < count; ++i)
+  {
+    after = ascending.insert(after, i, "x");
+    before = descending.insert(before, count - i, "x");
+  }
+
+  for (const Map<std::int32_t>* map : { &ascending, &descending })
+  {
+    BOOST_CHECK_EQUAL(map->getSize(), count);
+    BOOST_CHECK_LE(map->searchStats().searches, count);
+    BOOST_CHECK_LE(map->searchStats().comparisons, 3 * count);
+    BOOST_CHECK_LE(map->shape().height, 2 * 17 + 1);
+  }
+  BOOST_CHECK_EQUAL(ascending.begin()->first, 0);
+  BOOST_CHECK_EQUAL(std::prev(ascending.end())->first, count - 1);
+  BOOST_CHECK_EQUAL(descending.begin()->first, 1);
+  BOOST_CHECK_EQUAL(std::prev(descending.end())->first, count);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenHint_WhenSearchingForKey_ThenItemIsFoundFromAnyStartingPoint,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 100; ++i)
+    map[(i * 37) % 100] = std::to_string((i * 37) % 100);
+
+  for (auto hint = map.begin(); hint != map.end(); ++hint)
+  {
+    BOOST_CHECK_EQUAL(map.find(hint, 0)->second, "0");
+    BOOST_CHECK_EQUAL(map.find(hint, 99)->second, "99");
+    BOOST_CHECK_EQUAL(map.find(hint, 50)->second, "50");
+    BOOST_CHECK(map.find(hint, 100) == map.end());
+  }
+  BOOST_CHECK_EQUAL(map.find(map.end(), 42)->second, "42");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMaps_WhenTakingUnion_ThenPolicyResolvesCommonKeys,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> left = { { 1, "a" }, { 3, "c" }, { 5, "e" } };
+  const Map<K> right = { { 2, "B" }, { 3, "C" }, { 6, "F" } };
+
+  thenMapContainsItems(Map<K>::set_union(left, right),
+                       { { 1, "a" }, { 2, "B" }, { 3, "c" }, { 5, "e" }, { 6, "F" } });
+  thenMapContainsItems(Map<K>::set_union(left, right, aisdi::KeepRight()),
+                       { { 1, "a" }, { 2, "B" }, { 3, "C" }, { 5, "e" }, { 6, "F" } });
+  thenMapContainsItems(Map<K>::set_union(left, Map<K>{}), { { 1, "a" }, { 3, "c" }, { 5, "e" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMaps_WhenTakingIntersection_ThenOnlyCommonKeysRemain,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> left = { { 1, "a" }, { 3, "c" }, { 5, "e" }, { 7, "g" } };
+  const Map<K> right = { { 3, "C" }, { 4, "D" }, { 7, "G" } };
+
+  const auto result = Map<K>::set_intersection(left, right,
+      [](const std::string& l, const std::string& r) { return l + r; });
+
+  thenMapContainsItems(result, { { 3, "cC" }, { 7, "gG" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMaps_WhenTakingDifference_ThenKeysOfRightAreDropped,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> left = { { 1, "a" }, { 3, "c" }, { 5, "e" }, { 7, "g" } };
+  const Map<K> right = { { 0, "Z" }, { 3, "C" }, { 7, "G" } };
+
+  thenMapContainsItems(Map<K>::set_difference(left, right), { { 1, "a" }, { 5, "e" } });
+  thenMapContainsItems(Map<K>::set_difference(right, left), { { 0, "Z" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMaps_WhenMerging_ThenAllItemsAreInFirstMap,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
+  const Map<K> other = { { 1410, "Grunwald" }, { 1789, "Bastille" } };
+
+  map.merge(other, aisdi::KeepRight());
+
+  thenMapContainsItems(map, { { 753, "Rome" }, { 1410, "Grunwald" }, { 1789, "Bastille" } });
+  thenMapContainsItems(other, { { 1410, "Grunwald" }, { 1789, "Bastille" } });
+}
+
+struct ReverseThreeWay
+{
+  static std::size_t calls;
+
+  template <typename K>
+  bool operator()(const K& left, const K& right) const
+  {
+    calls++;
+    return right < left;
+  }
+
+  template <typename K>
+  int compare(const K& left, const K& right) const
+  {
+    calls++;
+    return left < right ? 1 : (right < left ? -1 : 0);
+  }
+};
+
+std::size_t ReverseThreeWay::calls = 0;
+
+struct CountingLess
+{
+  static std::size_t calls;
+
+  template <typename K>
+  bool operator()(const K& left, const K& right) const
+  {
+    calls++;
+    return left < right;
+  }
+};
+
+std::size_t CountingLess::calls = 0;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenReversedComparator_WhenIterating_ThenKeysAreInDescendingOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  aisdi::TreeMap<K, std::string, ReverseThreeWay> map = { { 27, "Bob" }, { 753, "Rome" }, { 42, "Alice" } };
+
+  map.remove(42);
+  auto it = map.begin();
+
+  BOOST_CHECK_EQUAL(it->first, 753);
+  BOOST_CHECK_EQUAL((++it)->first, 27);
+  BOOST_CHECK(++it == map.end());
+  BOOST_CHECK_EQUAL(map.valueOf(27), "Bob");
+  BOOST_CHECK(map.find(42) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenThreeWayComparator_WhenSearching_ThenOneComparisonIsMadePerLevel,
+                              K,
+                              TestedKeyTypes)
+{
+  std::vector<std::pair<K, std::string>> items;
+  for (int i = 1022; i >= 0; --i)
+    items.emplace_back(i, "x");
+  auto map = aisdi::TreeMap<K, std::string, ReverseThreeWay>::fromSorted(items.begin(), items.end());
+
+  for (int i = 0; i < 1023; ++i)
+  {
+    ReverseThreeWay::calls = 0;
+    BOOST_REQUIRE(map.find(i) != map.end());
+    BOOST_CHECK_LE(ReverseThreeWay::calls, 10);
+  }
+  ReverseThreeWay::calls = 0;
+  map[2000] = "y";
+  BOOST_CHECK_LE(ReverseThreeWay::calls, 10);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenLessOnlyComparator_WhenSearching_ThenOneComparisonIsMadePerLevelAndOneForEquality,
+                              K,
+                              TestedKeyTypes)
+{
+  std::vector<std::pair<K, std::string>> items;
+  for (int i = 0; i < 1023; ++i)
+    items.emplace_back(2 * i, "x");
+  auto map = aisdi::TreeMap<K, std::string, CountingLess>::fromSorted(items.begin(), items.end());
+
+  for (int i = 0; i < 2046; ++i)
+  {
+    CountingLess::calls = 0;
+    BOOST_CHECK_EQUAL(map.find(i) != map.end(), i % 2 == 0);
+    BOOST_CHECK_LE(CountingLess::calls, 11);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenStringKeys_WhenUsingDefaultComparator_ThenSingleThreeWayComparisonIsUsed)
+{
+  using Order = aisdi::KeyCompare<std::less<std::string>, std::string>;
+  aisdi::TreeMap<std::string, int> map = { { "pear", 1 }, { "apple", 2 }, { "peach", 3 } };
+
+  BOOST_CHECK(Order::threeWay);
+  BOOST_CHECK_LT(Order::compare(std::less<std::string>(), "apple", "pear"), 0);
+  BOOST_CHECK_EQUAL(map.begin()->first, "apple");
+  BOOST_CHECK_EQUAL(map.valueOf("peach"), 3);
+  BOOST_CHECK(map.find("plum") == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenSearchingBounds_ThenNeighbouringKeysAreReturned,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 1; i <= 100; ++i)
+    map[2 * i] = std::to_string(i);
+
+  BOOST_CHECK_EQUAL(map.lower_bound(0)->first, 2);
+  BOOST_CHECK_EQUAL(map.lower_bound(50)->first, 50);
+  BOOST_CHECK_EQUAL(map.lower_bound(51)->first, 52);
+  BOOST_CHECK_EQUAL(map.upper_bound(50)->first, 52);
+  BOOST_CHECK(map.lower_bound(201) == map.end());
+  BOOST_CHECK(map.upper_bound(200) == map.end());
+
+  const Map<K> empty;
+  BOOST_CHECK(empty.lower_bound(1) == empty.end());
+}
+
+BOOST_AUTO_TEST_CASE(GivenHierarchicalStringKeys_WhenTakingPrefixRange_ThenOnlyMatchingKeysAreVisited)
+{
+  aisdi::TreeMap<std::string, int> map = { { "a/b/c", 1 }, { "a/b", 2 }, { "a/bc", 3 }, { "a/b/", 4 },
+                                           { "a/a/z", 5 }, { "a/c", 6 }, { "b", 7 }, { "a/b/\xff", 8 },
+                                           { "a/b0", 9 }, { "a/b/\xff\xff", 10 } };
+
+  auto range = map.prefix_range("a/b/");
+  std::vector<std::string> visited;
+  for (auto it = range.first; it != range.second; ++it)
+    visited.push_back(it->first);
+  BOOST_CHECK((visited == std::vector<std::string>{ "a/b/", "a/b/c", "a/b/\xff", "a/b/\xff\xff" }));
+
+  auto all = map.prefix_range("");
+  BOOST_CHECK(all.first == map.begin());
+  BOOST_CHECK(all.second == map.end());
+
+  auto none = map.prefix_range("a/ba");
+  BOOST_CHECK(none.first == none.second);
+
+  auto last = map.prefix_range("b");
+  BOOST_CHECK_EQUAL(last.first->second, 7);
+  BOOST_CHECK(last.second == map.end());
+
+  auto tail = map.prefix_range("a/b/\xff");
+  BOOST_CHECK_EQUAL(std::distance(tail.first, tail.second), 2);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenBalancedMap_WhenTakingShape_ThenEveryLevelIsFull,
+                              K,
+                              TestedKeyTypes)
+{
+  std::vector<std::pair<K, std::string>> items;
+  for (int i = 0; i < 7; ++i)
+    items.emplace_back(i, "x");
+  const auto map = Map<K>::fromSorted(items.begin(), items.end());
+
+  const aisdi::TreeShape shape = map.shape();
+
+  BOOST_CHECK_EQUAL(shape.height, 3);
+  BOOST_CHECK_EQUAL(shape.maxDepth, 2);
+  BOOST_CHECK_EQUAL(shape.leaves, 4);
+  BOOST_CHECK_CLOSE(shape.averageDepth, 10.0 / 7, 1e-9);
+  BOOST_CHECK((shape.depthHistogram == std::vector<std::size_t>{ 1, 2, 4 }));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSequentiallyFilledMap_WhenTakingShape_ThenTreeIsAChain,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 100; ++i)
+    map[i] = "x";
+
+  const aisdi::TreeShape shape = map.shape();
+
+  BOOST_CHECK_EQUAL(shape.height, 100);
+  BOOST_CHECK_EQUAL(shape.leaves, 1);
+  BOOST_CHECK_CLOSE(shape.averageDepth, 49.5, 1e-9);
+  BOOST_CHECK((shape.depthHistogram == std::vector<std::size_t>(100, 1)));
+  BOOST_CHECK_EQUAL(Map<K>().shape().height, 0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenUnbalancedMap_WhenTakingShape_ThenLeavesAndDepthsAreCounted,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int key : { 50, 20, 80, 10, 30, 90, 25, 27 })
+    map[key] = "x";
+
+  const aisdi::TreeShape shape = map.shape();
+
+  BOOST_CHECK_EQUAL(shape.height, 5);
+  BOOST_CHECK_EQUAL(shape.leaves, 3);
+  BOOST_CHECK((shape.depthHistogram == std::vector<std::size_t>{ 1, 2, 3, 1, 1 }));
+}
+
+#ifdef AISDI_TREEMAP_STATS
+BOOST_AUTO_TEST_CASE(GivenChainShapedMap_WhenSearching_ThenEveryNodeOnThePathIsCounted)
+{
+  Map<std::int32_t> map;
+  for (int i = 0; i < 100; ++i)
+    map[i] = "x";
+  map.resetSearchStats();
+
+  map.find(99);
+  map.valueOf(0);
+
+  const aisdi::SearchStats stats = map.searchStats();
+  BOOST_CHECK_EQUAL(stats.searches, 2);
+  BOOST_CHECK_EQUAL(stats.visits, 101);
+  BOOST_CHECK_EQUAL(stats.comparisons, 101);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenVisitingItemsInParallel_ThenEveryItemIsVisitedOnce,
+                              K,
+                              TestedKeyTypes)
+{
+  aisdi::ThreadPool pool(4);
+  Map<K> map;
+  for (int i = 0; i < 5000; ++i)
+    map[(i * 7919) % 5000] = "x";
+
+  map.parallel_for_each([](std::pair<const K, std::string>& item) { item.second += "y"; }, pool);
+
+  std::size_t visited = 0;
+  for (auto it = map.begin(); it != map.end(); ++it, ++visited)
+    BOOST_REQUIRE_EQUAL(it->second, "xy");
+  BOOST_CHECK_EQUAL(visited, 5000);
+}
+
+BOOST_AUTO_TEST_CASE(GivenNonEmptyMap_WhenReducingInParallel_ThenResultMatchesSequentialFoldInKeyOrder)
+{
+  aisdi::ThreadPool pool(4);
+  Map<std::int32_t> map;
+  std::string expected;
+  for (int i = 0; i < 3000; ++i)
+    map[(i * 7919) % 3000] = std::string(1, static_cast<char>('a' + (i * 7919) % 3000 % 26));
+  for (auto it = map.begin(); it != map.end(); ++it)
+    expected += it->second;
+
+  const Map<std::int32_t>& constMap = map;
+  std::string concatenated = constMap.parallel_reduce(
+    std::string(),
+    [](const std::string& partial, const std::pair<const std::int32_t, std::string>& item) {
+      return partial + item.second;
+    },
+    [](const std::string& left, const std::string& right) { return left + right; },
+    pool);
+
+  BOOST_CHECK_EQUAL(concatenated, expected);
+  auto countItem = [](int partial, const std::pair<const std::int32_t, std::string>&) { return partial + 1; };
+  BOOST_CHECK_EQUAL(constMap.parallel_reduce(0, countItem, std::plus<int>(), pool), 3000);
+  BOOST_CHECK_EQUAL(Map<std::int32_t>().parallel_reduce(0, countItem, std::plus<int>(), pool), 0);
+}
+
+BOOST_AUTO_TEST_CASE(GivenThrowingFunction_WhenVisitingItemsInParallel_ThenExceptionIsRethrown)
+{
+  Map<std::int32_t> map;
+  for (int i = 0; i < 1000; ++i)
+    map[(i * 7919) % 1000] = "x";
+
+  BOOST_CHECK_THROW(map.parallel_for_each([](const std::pair<const std::int32_t, std::string>& item) {
+    if (item.first == 500)
+      throw std::runtime_error("bad item");
+  }), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenUnsortedItemsWithDuplicates_WhenBuilding_ThenLastValueWinsAndTreeIsBalanced,
+                              K,
+                              TestedKeyTypes)
+{
+  aisdi::ThreadPool pool(4);
+  std::vector<std::pair<const K, std::string>> items;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 20000; ++i)
+  {
+    const K key = (i * 7919) % 15000;
+    items.emplace_back(key, std::to_string(i));
+    expected[key] = std::to_string(i);
+  }
+
+  const auto map = Map<K>::build(std::move(items), std::less<K>(), pool);
+
+  BOOST_CHECK(items.empty());
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+  auto it = map.begin();
+  for (const auto& item : expected)
+  {
+    BOOST_REQUIRE(it != map.end());
+    BOOST_REQUIRE_EQUAL(it->first, item.first);
+    BOOST_REQUIRE_EQUAL(it->second, item.second);
+    ++it;
+  }
+  BOOST_CHECK_EQUAL(map.shape().height, 14);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenFewItems_WhenBuilding_ThenMapIsUsable,
+                              K,
+                              TestedKeyTypes)
+{
+  std::vector<std::pair<const K, std::string>> items = { { 42, "Alice" }, { 27, "Bob" }, { 42, "Carol" } };
+
+  auto map = Map<K>::build(std::move(items));
+  map[13] = "Dave";
+
+  thenMapContainsItems(map, { { 13, "Dave" }, { 27, "Bob" }, { 42, "Carol" } });
+  BOOST_CHECK(Map<K>::build(std::vector<std::pair<const K, std::string>>()).isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSortedBatch_WhenApplyingIt_ThenMapMatchesSeparateUpdates,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 2000; ++i)
+  {
+    const K key = (i * 7919) % 4000;
+    map[key] = "old";
+    expected[key] = "old";
+  }
+  std::vector<std::pair<const K, std::string>> upserts;
+  std::vector<K> deletes;
+  for (int i = 0; i < 4100; i += 3)
+  {
+    upserts.emplace_back(i, std::to_string(i));
+    deletes.push_back(i + 1);
+  }
+  for (const auto& key : deletes)
+    expected.erase(key);
+  for (const auto& item : upserts)
+    expected[item.first] = item.second;
+
+  map.applyBatch(upserts, deletes);
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenKeyInBothParts_WhenApplyingBatch_ThenUpsertWins,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "a" }, { 2, "b" } };
+
+  map.applyBatch(std::vector<std::pair<const K, std::string>>{ { 2, "B" } }, std::vector<K>{ 1, 2, 3 });
+
+  thenMapContainsItems(map, { { 2, "B" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenUnsortedBatch_WhenApplyingIt_ThenNothingIsChanged,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "a" } };
+
+  BOOST_CHECK_THROW(map.applyBatch(std::vector<std::pair<const K, std::string>>{ { 3, "c" }, { 2, "b" } },
+                                   std::vector<K>()),
+                    std::invalid_argument);
+  BOOST_CHECK_THROW(map.applyBatch(std::vector<std::pair<const K, std::string>>(), std::vector<K>{ 1, 1 }),
+                    std::invalid_argument);
+  thenMapContainsItems(map, { { 1, "a" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenChainShapedMap_WhenApplyingBatch_ThenTreeIsRebalanced,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 1000; ++i)
+    map[i] = "x";
+
+  map.applyBatch(std::vector<std::pair<const K, std::string>>{ { 1000, "y" }, { 1001, "y" } }, std::vector<K>{ 0 });
+
+  BOOST_CHECK_EQUAL(map.getSize(), 1001);
+  BOOST_CHECK_EQUAL(map.shape().height, 10);
+  BOOST_CHECK_EQUAL(map.valueOf(1001), "y");
+  BOOST_CHECK(map.find(0) == map.end());
+}
+
+#ifdef AISDI_TREEMAP_STATS
+BOOST_AUTO_TEST_CASE(GivenLargeBatchAppendedPastTheEnd_WhenApplying_ThenEachKeyTakesConstantComparisons)
+{
+  Map<std::int32_t> map;
+  for (int i = 0; i < 1000; ++i)
+    map[(i * 7919) % 1000] = "x";
+  std::vector<std::pair<const std::int32_t, std::string>> upserts;
+  for (int i = 1000; i < 101000; ++i)
+    upserts.emplace_back(i, "y");
+  map.resetSearchStats();
+
+  map.applyBatch(upserts, std::vector<std::int32_t>());
+
+  BOOST_CHECK_LE(map.searchStats().comparisons, 3 * upserts.size());
+  BOOST_CHECK_EQUAL(map.getSize(), 101000);
+  BOOST_CHECK_LE(map.shape().height, 2 * 17 + 1);
+  BOOST_CHECK_EQUAL(map.valueOf(999), "x");
+  BOOST_CHECK_EQUAL(map.valueOf(100999), "y");
+}
+#endif
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenValuesOutOfLine_WhenAddingRemovingAndCopying_ThenMapBehavesAsUsual,
+                              K,
+                              TestedKeyTypes)
+{
+  using OutOfLineMap = aisdi::TreeMap<K, std::string, std::less<K>, aisdi::NodePool<std::pair<const K, std::string>>,
+                                      aisdi::OutOfLineValues>;
+  std::map<K, std::string> expected;
+  {
+    OutOfLineMap map;
+    for (int i = 0; i < 300; ++i)
+    {
+      map[(i * 7919) % 500] = std::to_string(i);
+      expected[(i * 7919) % 500] = std::to_string(i);
+    }
+    for (int i = 0; i < 500; i += 3)
+      if (expected.erase(i) != 0)
+        map.remove(i);
+    OutOfLineMap copy{map};
+    map.clear();
+
+    BOOST_CHECK(map.isEmpty());
+    BOOST_CHECK_EQUAL(copy.getSize(), expected.size());
+    auto it = copy.begin();
+    for (const auto& item : expected)
+    {
+      BOOST_REQUIRE(it != copy.end());
+      BOOST_CHECK_EQUAL(it->first, item.first);
+      BOOST_CHECK_EQUAL(it->second, item.second);
+      ++it;
+    }
+  }
+  expected.clear();
+
+  BOOST_CHECK_EQUAL(OperationCountingObject::constructedObjectsCount(),
+                    OperationCountingObject::destroyedObjectsCount());
+}
+
+BOOST_AUTO_TEST_CASE(GivenLargeValues_WhenUsingDefaultLayout_ThenTheyAreStoredOutOfLine)
+{
+  struct Large
+  {
+    int value;
+    char padding[120];
+  };
+  static_assert(aisdi::TreeMap<int, Large>::VALUES_OUT_OF_LINE, "large values should be stored out of line");
+  static_assert(!aisdi::TreeMap<int, int>::VALUES_OUT_OF_LINE, "small values should stay in the node");
+  static_assert(!aisdi::TreeMap<int, Large, std::less<int>, aisdi::NodePool<std::pair<const int, Large>>,
+                                aisdi::InlineValues>::VALUES_OUT_OF_LINE,
+                "InlineValues should keep values in the node");
+  aisdi::TreeMap<int, Large> map;
+  for (int i = 0; i < 1000; ++i)
+    map[i].value = i;
+  const Large* address = &map.valueOf(501);
+
+  for (int i = 0; i < 1000; i += 2)
+    map.remove(i);
+  map[2000].value = 2000;
+
+  BOOST_CHECK(&map.valueOf(501) == address);
+  BOOST_CHECK_EQUAL(map.getSize(), 501);
+  for (const auto& item : map)
+    BOOST_CHECK_EQUAL(item.second.value, item.first);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenChurnedMap_WhenCompacting_ThenItemsArePreservedAndTreeIsBalanced,
+                              K,
+                              TestedKeyTypes)
+{
+  std::map<K, std::string> expected;
+  {
+    Map<K> map;
+    for (int i = 0; i < 3000; ++i)
+    {
+      const int key = (i * 7919) % 1000;
+      if (i % 3 == 2 && expected.erase(key) != 0)
+        map.remove(key);
+      else
+      {
+        map[key] = std::to_string(i);
+        expected[key] = std::to_string(i);
+      }
+    }
+
+    map.compact();
+
+    thenMapContainsItems(map, expected);
+    std::size_t optimal = 0;
+    for (std::size_t count = map.getSize(); count > 0; count >>= 1)
+      optimal++;
+    BOOST_CHECK_EQUAL(map.shape().height, optimal);
+    map[5000] = "new";
+    BOOST_CHECK_EQUAL(map.valueOf(5000), "new");
+  }
+  expected.clear();
+
+  BOOST_CHECK_EQUAL(OperationCountingObject::constructedObjectsCount(),
+                    OperationCountingObject::destroyedObjectsCount());
+}
+
+BOOST_AUTO_TEST_CASE(GivenValueThrowingOnCopy_WhenCompacting_ThenMapIsUnchanged)
+{
+  struct Fragile
+  {
+    int value;
+    Fragile(int value_ = 0) : value(value_)
+    {}
+    // not noexcept, so compact() has to copy.
+    Fragile(Fragile&& other) : value(other.value)
+    {}
+    Fragile(const Fragile& other) : value(other.value)
+    {
+      if (value == 42)
+        throw std::runtime_error("copy failed");
+    }
+    Fragile& operator=(const Fragile&) = default;
+  };
+  aisdi::TreeMap<int, Fragile> map;
+  for (int i = 0; i < 100; ++i)
+    map[i] = Fragile(i);
+
+  BOOST_CHECK_THROW(map.compact(), std::runtime_error);
+
+  BOOST_CHECK_EQUAL(map.getSize(), 100);
+  for (int i = 0; i < 100; ++i)
+    BOOST_CHECK_EQUAL(map.valueOf(i).value, i);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenBloomFilter_WhenChangingMap_ThenLookupsMatchReference,
+                              K,
+                              HashedKeyTypes)
+{
+  Map<K> map;
+  map.useBloomFilter(true);
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 3000; ++i)
+  {
+    const int key = (i * 7919) % 1000;
+    if (i % 3 == 2 && expected.erase(key) != 0)
+      map.remove(key);
+    else
+    {
+      map[key] = std::to_string(i);
+      expected[key] = std::to_string(i);
+    }
+  }
+
+  BOOST_CHECK(map.usesBloomFilter());
+  thenMapContainsItems(map, expected);
+  for (int key = 0; key < 1000; ++key)
+    BOOST_CHECK_EQUAL(map.find(key) != map.end(), expected.count(key) == 1);
+
+  Map<K> copy{map};
+  map.clear();
+  BOOST_CHECK(copy.usesBloomFilter());
+  BOOST_CHECK(map.find(expected.begin()->first) == map.end());
+  thenMapContainsItems(copy, expected);
+}
+
+BOOST_AUTO_TEST_CASE(GivenBloomFilter_WhenLookingUpMissingKeys_ThenMostSkipTheDescent)
+{
+  Map<int> map;
+  for (int i = 0; i < 1000; ++i)
+    map[2 * i] = "x";
+  map.useBloomFilter(true);
+  map.resetSearchStats();
+
+  for (int i = 0; i < 1000; ++i)
+    BOOST_CHECK(map.find(2 * i + 1) == map.end());
+
+  BOOST_CHECK_LT(map.searchStats().searches, 50);
+  map.useBloomFilter(false);
+  BOOST_CHECK(!map.usesBloomFilter());
+  BOOST_CHECK(map.find(2) != map.end());
+}
+
 // ConstIterator is tested via Iterator methods.
 // If Iterator methods are to be changed, then new ConstIterator tests are required.
 